@@ -0,0 +1,710 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "meve.h"
+
+/* Version of the output format.		*/
+#define BENCH_FORMAT			1
+
+/* Tokens processed by one timed pass over a corpus.	*/
+#define BENCH_PASS_TOKENS		(1 << 18)
+
+/* Timed passes per stage; the fastest one is reported.	*/
+#define BENCH_PASSES			7
+
+/* Size of the token buffer, enough for the longest expression.	*/
+#define BENCH_MAXTOKENS			8192
+
+/* Size of the buffer used to generate an expression.	*/
+#define BENCH_MAXLEN_EXPR		(1 << 15)
+
+/* Maximum number of baseline records.	*/
+#define BENCH_MAXRECORDS		64
+
+/* Expression being generated.			*/
+typedef struct BENCH_STR
+{
+	char buff[BENCH_MAXLEN_EXPR];	/* Expression text.					*/
+	size_t len;					/* Expression length.					*/
+	uint32_t seed;				/* State of the generator.				*/
+}BENCH_STR;
+
+/* Set of generated expressions.		*/
+typedef struct BENCH_CORPUS
+{
+	const char* name;			/* Name of the corpus.					*/
+	void (*gen)(BENCH_STR*);	/* Generates one expression.			*/
+	size_t count;				/* Number of expressions.				*/
+	char** exprs;				/* Pointer to the expressions.			*/
+	MTOKEN** infix;				/* Infix tokens of each expression.		*/
+	size_t* inLen;				/* Number of infix tokens.				*/
+	MTOKEN** postfix;			/* Postfix tokens of each expression.	*/
+	size_t* postLen;			/* Number of postfix tokens.			*/
+	MEVE_PROGRAM* progs;		/* Compiled program of each expression.	*/
+	size_t tokens;				/* Infix tokens of the whole corpus.	*/
+	size_t reps;				/* Sweeps of the corpus per pass.		*/
+}BENCH_CORPUS;
+
+/* Timed stage.							*/
+typedef struct BENCH_STAGE
+{
+	const char* name;			/* Name of the stage.					*/
+	void (*run)(const BENCH_CORPUS*);	/* Runs one sweep of the corpus.	*/
+	void (*base)(const BENCH_CORPUS*);	/* Setup timed apart and subtracted.	*/
+}BENCH_STAGE;
+
+/* Record of a baseline file.			*/
+typedef struct BENCH_RECORD
+{
+	char corpus[32];			/* Name of the corpus.					*/
+	char stage[32];				/* Name of the stage.					*/
+	double ns;					/* Nanoseconds per expression.			*/
+}BENCH_RECORD;
+
+static num_t gX = 1.25;
+static num_t gY = 0.5;
+static const MEVE_VAR gVars[] = { { "x", &gX }, { "y", &gY } };
+
+static MTOKEN gTkBuff[BENCH_MAXTOKENS];
+static MEVE_CONTEXT gCtx;
+
+static double BenchNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* xorshift32, so the corpus does not depend on the C library. */
+static uint32_t BenchRand(
+	BENCH_STR* s,
+	const uint32_t n)
+{
+	s->seed ^= s->seed << 13;
+	s->seed ^= s->seed >> 17;
+	s->seed ^= s->seed << 5;
+	return s->seed % n;
+}
+
+static void BenchPut(
+	BENCH_STR* s,
+	const char* str)
+{
+	const size_t len = strlen(str);
+
+	if (s->len + len < sizeof(s->buff))
+	{
+		memcpy(&s->buff[s->len], str, len + 1);
+		s->len += len;
+	}
+}
+
+static void BenchPutOpr(
+	BENCH_STR* s)
+{
+	static const char* const oprs[] = { "+", "-", "*", "/", "+", "-" };
+
+	BenchPut(s, oprs[BenchRand(s, sizeof(oprs) / sizeof(oprs[0]))]);
+}
+
+static void BenchPutNum(
+	BENCH_STR* s,
+	const bool longNum)
+{
+	char num[48];
+
+	if (!longNum)
+	{
+		snprintf(num, sizeof(num), "%u", (unsigned)BenchRand(s, 100) + 1);
+	}
+	else
+	{
+		switch (BenchRand(s, 4))
+		{
+			case 0:
+			{
+				snprintf(num, sizeof(num), "%u.%06u", (unsigned)BenchRand(s, 10000),
+					(unsigned)BenchRand(s, 1000000));
+				break;
+			}
+			case 1:
+			{
+				snprintf(num, sizeof(num), "%u.%03ue-%u", (unsigned)BenchRand(s, 10),
+					(unsigned)BenchRand(s, 1000), (unsigned)BenchRand(s, 9) + 1);
+				break;
+			}
+			case 2:
+			{
+				snprintf(num, sizeof(num), "0.%09u", (unsigned)BenchRand(s, 1000000000));
+				break;
+			}
+			default:
+			{
+				snprintf(num, sizeof(num), "%u", (unsigned)BenchRand(s, 1000000));
+			}
+		}
+	}
+	BenchPut(s, num);
+}
+
+static void BenchPutOperand(
+	BENCH_STR* s)
+{
+	switch (BenchRand(s, 3))
+	{
+		case 0:
+		{
+			BenchPut(s, "x");
+			break;
+		}
+		case 1:
+		{
+			BenchPut(s, "y");
+			break;
+		}
+		default:
+		{
+			BenchPutNum(s, false);
+		}
+	}
+}
+
+static void BenchPutCall(
+	BENCH_STR* s,
+	const unsigned depth)
+{
+	static const char* const unary[] =
+	{
+		"sin", "cos", "tan", "exp", "sqrt", "abs", "log", "log10", "arctan"
+	};
+	static const char* const binary[] = { "min", "max" };
+
+	if (!depth)
+	{
+		BenchPutOperand(s);
+		return;
+	}
+
+	if (BenchRand(s, 4))
+	{
+		BenchPut(s, unary[BenchRand(s, sizeof(unary) / sizeof(unary[0]))]);
+		BenchPut(s, "(");
+		BenchPutCall(s, depth - 1);
+		BenchPutOpr(s);
+		BenchPutOperand(s);
+	}
+	else
+	{
+		BenchPut(s, binary[BenchRand(s, sizeof(binary) / sizeof(binary[0]))]);
+		BenchPut(s, "(");
+		BenchPutCall(s, depth - 1);
+		BenchPut(s, ",");
+		BenchPutCall(s, depth - 1);
+	}
+	BenchPut(s, ")");
+}
+
+static void BenchPutNested(
+	BENCH_STR* s,
+	const unsigned depth)
+{
+	if (!depth)
+	{
+		BenchPutOperand(s);
+		return;
+	}
+
+	BenchPut(s, "(");
+
+	/* Nests on either side, so both stacks of the converter grow. */
+	if (BenchRand(s, 2))
+	{
+		BenchPutNested(s, depth - 1);
+		BenchPutOpr(s);
+		BenchPutOperand(s);
+	}
+	else
+	{
+		BenchPutOperand(s);
+		BenchPutOpr(s);
+		BenchPutNested(s, depth - 1);
+	}
+	BenchPut(s, ")");
+}
+
+/* A handful of operators and operands, e.g. 3*x+7. */
+static void GenShort(
+	BENCH_STR* s)
+{
+	const unsigned terms = 2 + BenchRand(s, 4);
+
+	BenchPutOperand(s);
+
+	for (unsigned i = 1; i < terms; i++)
+	{
+		BenchPutOpr(s);
+		BenchPutOperand(s);
+	}
+}
+
+/* Brackets nested 8 to 39 levels deep. */
+static void GenNested(
+	BENCH_STR* s)
+{
+	BenchPutNested(s, 8 + BenchRand(s, 32));
+}
+
+/* Sums of calls nested up to three levels deep. */
+static void GenFunctions(
+	BENCH_STR* s)
+{
+	const unsigned terms = 1 + BenchRand(s, 3);
+
+	for (unsigned i = 0; i < terms; i++)
+	{
+		if (i)
+		{
+			BenchPutOpr(s);
+		}
+		BenchPutCall(s, 1 + BenchRand(s, 3));
+	}
+}
+
+/* Long decimal and scientific literals. */
+static void GenLiterals(
+	BENCH_STR* s)
+{
+	const unsigned terms = 4 + BenchRand(s, 8);
+
+	BenchPutNum(s, true);
+
+	for (unsigned i = 1; i < terms; i++)
+	{
+		BenchPutOpr(s);
+		BenchPutNum(s, true);
+	}
+}
+
+/* Hundreds of terms, some of them calls or bracketed. */
+static void GenLong(
+	BENCH_STR* s)
+{
+	const unsigned terms = 200 + BenchRand(s, 400);
+
+	BenchPutOperand(s);
+
+	for (unsigned i = 1; i < terms; i++)
+	{
+		BenchPutOpr(s);
+
+		switch (BenchRand(s, 8))
+		{
+			case 0:
+			{
+				BenchPutCall(s, 1);
+				break;
+			}
+			case 1:
+			{
+				BenchPutNested(s, 2);
+				break;
+			}
+			default:
+			{
+				BenchPutOperand(s);
+			}
+		}
+	}
+}
+
+static void StageTokens(
+	const BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		gCtx.iStr = c->exprs[i];
+		MeveUpdate(&gCtx);
+		CreateTokens(&gCtx);
+	}
+}
+
+/* Copies the infix tokens back, since the conversion overwrites them. */
+static void StageRestore(
+	const BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		memcpy(gCtx.expr.tk, c->infix[i], c->inLen[i] * sizeof(MTOKEN));
+		gCtx.expr.len = c->inLen[i];
+		gCtx.expr.top = &gCtx.expr.tk[c->inLen[i] - 1];
+	}
+}
+
+static void StagePostfix(
+	const BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		memcpy(gCtx.expr.tk, c->infix[i], c->inLen[i] * sizeof(MTOKEN));
+		gCtx.expr.len = c->inLen[i];
+		gCtx.expr.top = &gCtx.expr.tk[c->inLen[i] - 1];
+		InfixToPostfix(&gCtx);
+	}
+}
+
+static void StageEval(
+	const BENCH_CORPUS* c)
+{
+	const TSTACK expr = gCtx.expr;
+
+	/* The postfix tokens are only read, so they are evaluated in place. */
+	for (size_t i = 0; i < c->count; i++)
+	{
+		gCtx.expr.tk = c->postfix[i];
+		gCtx.expr.len = c->postLen[i];
+		gCtx.expr.top = &c->postfix[i][c->postLen[i] - 1];
+		PostfixEval(&gCtx);
+	}
+
+	gCtx.expr = expr;
+}
+
+static void StageString(
+	const BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		gCtx.iStr = c->exprs[i];
+		MeveUpdate(&gCtx);
+		EvalString(&gCtx);
+	}
+}
+
+static void StageRun(
+	const BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		MeveRun(&c->progs[i], &gCtx.ans);
+	}
+}
+
+static MTOKEN* BenchCopyTokens(
+	const TSTACK* expr)
+{
+	MTOKEN* tk = malloc(expr->len * sizeof(MTOKEN));
+
+	if (tk)
+	{
+		memcpy(tk, expr->tk, expr->len * sizeof(MTOKEN));
+	}
+	return tk;
+}
+
+/* Generates a corpus and keeps the tokens and the program of each
+ * expression, so every stage can be timed on its own input. */
+static bool CorpusInit(
+	BENCH_CORPUS* c,
+	const uint32_t seed)
+{
+	BENCH_STR* s = malloc(sizeof(BENCH_STR));
+
+	c->exprs = calloc(c->count, sizeof(char*));
+	c->infix = calloc(c->count, sizeof(MTOKEN*));
+	c->inLen = calloc(c->count, sizeof(size_t));
+	c->postfix = calloc(c->count, sizeof(MTOKEN*));
+	c->postLen = calloc(c->count, sizeof(size_t));
+	c->progs = calloc(c->count, sizeof(MEVE_PROGRAM));
+	c->tokens = 0;
+
+	if (!s || !c->exprs || !c->infix || !c->inLen || !c->postfix || !c->postLen || !c->progs)
+	{
+		free(s);
+		return false;
+	}
+
+	s->seed = seed;
+
+	for (size_t i = 0; i < c->count; i++)
+	{
+		MeveCode res;
+
+		s->len = 0;
+		s->buff[0] = '\0';
+		c->gen(s);
+
+		if (!(c->exprs[i] = malloc(s->len + 1)))
+		{
+			free(s);
+			return false;
+		}
+		memcpy(c->exprs[i], s->buff, s->len + 1);
+
+		gCtx.iStr = c->exprs[i];
+		MeveUpdate(&gCtx);
+
+		if ((res = CreateTokens(&gCtx)) == MEVE_ERR_OK)
+		{
+			c->inLen[i] = gCtx.expr.len;
+			c->infix[i] = BenchCopyTokens(&gCtx.expr);
+			res = InfixToPostfix(&gCtx);
+		}
+
+		if (res == MEVE_ERR_OK)
+		{
+			c->postLen[i] = gCtx.expr.len;
+			c->postfix[i] = BenchCopyTokens(&gCtx.expr);
+			res = MeveCompile(&gCtx, &c->progs[i]);
+		}
+
+		if (res != MEVE_ERR_OK || !c->infix[i] || !c->postfix[i])
+		{
+			fprintf(stderr, "%s: error %d in \"%s\"\n", c->name, (int)res, c->exprs[i]);
+			free(s);
+			return false;
+		}
+
+		c->tokens += c->inLen[i];
+	}
+
+	c->reps = BENCH_PASS_TOKENS / c->tokens + 1;
+	free(s);
+	return true;
+}
+
+static void CorpusFree(
+	BENCH_CORPUS* c)
+{
+	for (size_t i = 0; i < c->count; i++)
+	{
+		if (c->exprs)
+		{
+			free(c->exprs[i]);
+		}
+
+		if (c->infix)
+		{
+			free(c->infix[i]);
+		}
+
+		if (c->postfix)
+		{
+			free(c->postfix[i]);
+		}
+
+		if (c->progs)
+		{
+			MeveFree(&c->progs[i]);
+		}
+	}
+
+	free(c->exprs);
+	free(c->infix);
+	free(c->inLen);
+	free(c->postfix);
+	free(c->postLen);
+	free(c->progs);
+}
+
+/* Returns the fastest of the timed passes, in nanoseconds. */
+static double BenchTime(
+	void (*run)(const BENCH_CORPUS*),
+	const BENCH_CORPUS* c)
+{
+	double best = 0;
+
+	/* The first pass only warms up the caches. */
+	for (int pass = 0; pass <= BENCH_PASSES; pass++)
+	{
+		const double start = BenchNow();
+		double elapsed;
+
+		for (size_t r = 0; r < c->reps; r++)
+		{
+			run(c);
+		}
+
+		elapsed = BenchNow() - start;
+
+		if (pass == 1 || (pass > 1 && elapsed < best))
+		{
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+static size_t BaselineLoad(
+	const char* path,
+	BENCH_RECORD* recs)
+{
+	FILE* in = fopen(path, "r");
+	char line[256];
+	size_t n = 0;
+
+	if (!in)
+	{
+		perror(path);
+		return 0;
+	}
+
+	while (n < BENCH_MAXRECORDS && fgets(line, sizeof(line), in))
+	{
+		if (line[0] != '#' &&
+			sscanf(line, "%31s %31s %*s %*s %lf", recs[n].corpus, recs[n].stage, &recs[n].ns) == 3)
+		{
+			n++;
+		}
+	}
+
+	fclose(in);
+	return n;
+}
+
+static const BENCH_RECORD* BaselineFind(
+	const BENCH_RECORD* recs,
+	const size_t n,
+	const char* corpus,
+	const char* stage)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		if (!strcmp(recs[i].corpus, corpus) && !strcmp(recs[i].stage, stage))
+		{
+			return &recs[i];
+		}
+	}
+	return NULL;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+		"usage: meve-bench [-c baseline] [-t percent]\n"
+		"  -c  compares with the output of a previous run and fails when a\n"
+		"      stage is slower than the threshold\n"
+		"  -t  threshold of -c, in percent (default 10)\n");
+}
+
+int main(
+	int argc,
+	char** argv)
+{
+	static const BENCH_STAGE stages[] =
+	{
+		{ "CreateTokens",	&StageTokens,	NULL			},
+		{ "InfixToPostfix",	&StagePostfix,	&StageRestore	},
+		{ "PostfixEval",	&StageEval,		NULL			},
+		{ "EvalString",		&StageString,	NULL			},
+		{ "MeveRun",		&StageRun,		NULL			},
+	};
+	BENCH_CORPUS corpora[] =
+	{
+		{ "short",		&GenShort,		4000	},
+		{ "nested",		&GenNested,		1000	},
+		{ "functions",	&GenFunctions,	2000	},
+		{ "literals",	&GenLiterals,	2000	},
+		{ "long",		&GenLong,		100		},
+	};
+	const size_t corporaLen = sizeof(corpora) / sizeof(corpora[0]);
+	BENCH_RECORD* recs = NULL;
+	const char* baseline = NULL;
+	double threshold = 10;
+	size_t recsLen = 0;
+	int status = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-c") && i + 1 < argc)
+		{
+			baseline = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (baseline)
+	{
+		if (!(recs = malloc(BENCH_MAXRECORDS * sizeof(BENCH_RECORD))) ||
+			!(recsLen = BaselineLoad(baseline, recs)))
+		{
+			free(recs);
+			return 2;
+		}
+	}
+
+	MeveInit(&gCtx, gTkBuff, sizeof(gTkBuff), "");
+	MeveSetVars(&gCtx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+
+	for (size_t i = 0; i < corporaLen; i++)
+	{
+		if (!CorpusInit(&corpora[i], 0x9E3779B9u + (uint32_t)i))
+		{
+			for (size_t j = 0; j <= i; j++)
+			{
+				CorpusFree(&corpora[j]);
+			}
+			free(recs);
+			return 2;
+		}
+	}
+
+	/* Tab-separated records, so two runs can be diffed or compared. */
+	printf("# meve-bench %d\n", BENCH_FORMAT);
+	printf("# precision\t%s\n", sizeof(num_t) == sizeof(float) ? "float" :
+		sizeof(num_t) == sizeof(double) ? "double" : "long double");
+	printf("# corpus\tstage\texprs\ttokens\tns/expr\tMtokens/s%s\n",
+		recs ? "\tbase\tchange" : "");
+
+	for (size_t i = 0; i < corporaLen; i++)
+	{
+		const BENCH_CORPUS* c = &corpora[i];
+
+		for (size_t j = 0; j < sizeof(stages) / sizeof(stages[0]); j++)
+		{
+			double ns = BenchTime(stages[j].run, c);
+			const BENCH_RECORD* rec;
+
+			if (stages[j].base)
+			{
+				ns -= BenchTime(stages[j].base, c);
+			}
+
+			ns /= (double)c->reps;
+
+			printf("%s\t%s\t%zu\t%zu\t%.1f\t%.2f", c->name, stages[j].name, c->count,
+				c->tokens, ns / (double)c->count, (double)c->tokens / ns * 1e3);
+
+			if (recs && (rec = BaselineFind(recs, recsLen, c->name, stages[j].name)))
+			{
+				const double change = (ns / (double)c->count / rec->ns - 1) * 100;
+
+				printf("\t%.1f\t%+.1f%%", rec->ns, change);
+
+				if (change > threshold)
+				{
+					status = 1;
+				}
+			}
+			printf("\n");
+			fflush(stdout);
+		}
+	}
+
+	for (size_t i = 0; i < corporaLen; i++)
+	{
+		CorpusFree(&corpora[i]);
+	}
+
+	free(recs);
+	return status;
+}
@@ -0,0 +1,1890 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <math.h>
+#include "meve.h"
+#include "mevejit.h"
+#include "mevecache.h"
+#include "meveival.h"
+#include "mevediff.h"
+#include "meveincr.h"
+#include "mevebin.h"
+#include "mevepool.h"
+
+/* Expressions generated by each differential check.	*/
+#define CHECK_EXPRS				2000
+
+/* Inputs each generated expression is evaluated at.	*/
+#define CHECK_POINTS			16
+
+/* Size of the buffer used to generate an expression.	*/
+#define CHECK_MAXLEN_EXPR		4096
+
+/* Size of the token buffer, enough for the longest expression.	*/
+#define CHECK_MAXTOKENS			2048
+
+/* Programs kept by the caches of the checks.	*/
+#define CHECK_CACHESIZE			64
+
+/* Boxes each expression is bounded over by the interval check.	*/
+#define CHECK_BOXES				8
+
+/* Multiples of a divisor the mod bounds are checked next to.	*/
+#define CHECK_MULTIPLES			64
+
+/* Width in ulps of the boxes next to these multiples.	*/
+#define CHECK_ULPS				4
+
+/* Runs of each program by the incremental check.	*/
+#define CHECK_TICKS				64
+
+/* Programs written to the image of the round-trip check.	*/
+#define CHECK_IMAGEPROGS		64
+
+/* Offsets of the version and of the size of num_t in an image header.	*/
+#define CHECK_IMAGE_VERSION		4
+#define CHECK_IMAGE_NUMSIZE		6
+
+/* Ulps a rewrite of MEVE_FLAG_FASTMATH may move a result by.	*/
+#define CHECK_FASTULPS			64
+
+/* Largest n whose binomial coefficients all fit in 64 bits.	*/
+#define CHECK_CHOOSE_MAXN		67
+
+/* Threads of the pool check, the calling thread included.	*/
+#define CHECK_POOL_THREADS		4
+
+/* Expressions of the pool check, so that the workers steal chunks.	*/
+#define CHECK_POOL_EXPRS		(CHECK_POOL_THREADS * MEVE_POOL_EXPRS * 8 + 5)
+
+/* Rows of the pool check, with a partial range and a partial block.	*/
+#define CHECK_POOL_ROWS			(5 * MEVE_POOL_ROWS + MEVE_BATCH_BLOCK / 2 + 3)
+
+/* Programs run over the rows by the pool check.	*/
+#define CHECK_POOL_PROGS		16
+
+/* Expressions of the arena check, and the terms of its long sums.	*/
+#define CHECK_ARENA_EXPRS		256
+#define CHECK_ARENA_TERMS		300
+
+/* Nesting of the arena check, within the stacks of the large buffer.	*/
+#define CHECK_ARENA_DEPTH		100
+
+/* Size of the caller-supplied first block of the arena check.	*/
+#define CHECK_ARENA_BUFF		512
+
+/* Variables of the program whose gradient does not fit the stack.	*/
+#define CHECK_WIDEVARS			40
+
+/* Failures printed by each check before the rest are only counted.	*/
+#define CHECK_MAXREPORTS		5
+
+/* Expression being generated.			*/
+typedef struct CHECK_STR
+{
+	char buff[CHECK_MAXLEN_EXPR];	/* Expression text.					*/
+	size_t len;					/* Expression length.					*/
+	uint32_t seed;				/* State of the generator.				*/
+}CHECK_STR;
+
+static num_t gX;
+static num_t gY;
+static const MEVE_VAR gVars[] = { { "x", &gX }, { "y", &gY } };
+
+static MTOKEN gTkBuff[CHECK_MAXTOKENS];
+static num_t gPoolCols[2][CHECK_POOL_ROWS];
+static num_t gPoolWant[CHECK_POOL_ROWS];
+static num_t gPoolGot[CHECK_POOL_ROWS];
+
+static num_t gWide[CHECK_WIDEVARS];
+static char gWideNames[CHECK_WIDEVARS][8];
+static MEVE_VAR gWideVars[CHECK_WIDEVARS];
+
+/* xorshift32, so the expressions do not depend on the C library. */
+static uint32_t CheckRand(
+	CHECK_STR* s,
+	const uint32_t n)
+{
+	s->seed ^= s->seed << 13;
+	s->seed ^= s->seed >> 17;
+	s->seed ^= s->seed << 5;
+	return s->seed % n;
+}
+
+static void CheckPut(
+	CHECK_STR* s,
+	const char* str)
+{
+	const size_t len = strlen(str);
+
+	if (s->len + len < sizeof(s->buff))
+	{
+		memcpy(&s->buff[s->len], str, len + 1);
+		s->len += len;
+	}
+}
+
+/* Appends a random expression of at most depth levels. The operands are
+ * often taken from subs, so that the expression repeats them. */
+static void CheckPutExpr(
+	CHECK_STR* s,
+	const unsigned depth,
+	const char* const* subs,
+	const size_t subCount)
+{
+	static const char* const operands[] = { "x", "y", "0.5", "2", "3", "7", "1.5" };
+	static const char* const oprs[] = { "+", "-", "*", "/", "^", " mod ", " choose " };
+	static const char* const unary[] = { "sin", "cos", "tan", "exp", "sqrt", "abs", "log", "arctan", "-" };
+	static const char* const binary[] = { "min", "max" };
+
+	if (!depth || !CheckRand(s, 4))
+	{
+		if (subCount && !CheckRand(s, 2))
+		{
+			CheckPut(s, "(");
+			CheckPut(s, subs[CheckRand(s, (uint32_t)subCount)]);
+			CheckPut(s, ")");
+		}
+		else
+		{
+			CheckPut(s, operands[CheckRand(s, sizeof(operands) / sizeof(operands[0]))]);
+		}
+		return;
+	}
+
+	switch (CheckRand(s, 5))
+	{
+		case 0:
+		{
+			CheckPut(s, unary[CheckRand(s, sizeof(unary) / sizeof(unary[0]))]);
+			CheckPut(s, "(");
+			CheckPutExpr(s, depth - 1, subs, subCount);
+			break;
+		}
+		case 1:
+		{
+			CheckPut(s, binary[CheckRand(s, sizeof(binary) / sizeof(binary[0]))]);
+			CheckPut(s, "(");
+			CheckPutExpr(s, depth - 1, subs, subCount);
+			CheckPut(s, ",");
+			CheckPutExpr(s, depth - 1, subs, subCount);
+			break;
+		}
+		case 2:
+		{
+			CheckPut(s, "(");
+			CheckPutExpr(s, depth - 1, subs, subCount);
+			CheckPut(s, ")!");
+			return;
+		}
+		default:
+		{
+			CheckPut(s, "(");
+			CheckPutExpr(s, depth - 1, subs, subCount);
+			CheckPut(s, oprs[CheckRand(s, sizeof(oprs) / sizeof(oprs[0]))]);
+			CheckPutExpr(s, depth - 1, subs, subCount);
+		}
+	}
+	CheckPut(s, ")");
+}
+
+/* Generates an expression repeating two smaller ones. */
+static void CheckGen(
+	CHECK_STR* s)
+{
+	CHECK_STR sub[2];
+	const char* subs[2];
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		sub[i].len = 0;
+		sub[i].buff[0] = '\0';
+		sub[i].seed = s->seed + (uint32_t)i * 0x9E3779B9u + 1;
+		CheckPutExpr(&sub[i], 2, NULL, 0);
+		subs[i] = sub[i].buff;
+		CheckRand(s, 2);
+	}
+
+	s->len = 0;
+	s->buff[0] = '\0';
+	CheckPutExpr(s, 4, subs, 2);
+}
+
+/* Sets the variables to a random point of [-4, 4]. */
+static void CheckPoint(
+	CHECK_STR* s)
+{
+	gX = (num_t)CheckRand(s, 8001) / 1000 - 4;
+	gY = (num_t)CheckRand(s, 8001) / 1000 - 4;
+}
+
+/* Whether two results are the same bits, any NaN matching any NaN. */
+static bool CheckSame(
+	const num_t a,
+	const num_t b)
+{
+	return (isnan(a) && isnan(b)) || (a == b && signbit(a) == signbit(b));
+}
+
+/* Evaluates an expression through the postfix interpreter. */
+static MeveCode CheckEval(
+	const char* str,
+	num_t* res)
+{
+	MEVE_CONTEXT ctx;
+	MeveCode code;
+
+	MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), str);
+	MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+	code = EvalString(&ctx);
+	*res = ctx.ans;
+	return code;
+}
+
+static MeveCode CheckCompileVars(
+	const char* str,
+	const MEVE_VAR* vars,
+	const size_t varCount,
+	MEVE_PROGRAM* prog)
+{
+	MEVE_CONTEXT ctx;
+
+	MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), str);
+	MeveSetVars(&ctx, vars, varCount);
+	return MeveCompile(&ctx, prog);
+}
+
+static MeveCode CheckCompile(
+	const char* str,
+	MEVE_PROGRAM* prog)
+{
+	return CheckCompileVars(str, gVars, sizeof(gVars) / sizeof(gVars[0]), prog);
+}
+
+static void CheckReport(
+	size_t* fails,
+	const char* check,
+	const char* str,
+	const char* what,
+	const num_t want,
+	const num_t got)
+{
+	if (++*fails <= CHECK_MAXREPORTS)
+	{
+		printf("%s: %s at x=%" MEVE_NUM_FMT " y=%" MEVE_NUM_FMT ": %s, expected %.*" MEVE_NUM_FMT
+			" got %.*" MEVE_NUM_FMT "\n", check, str, gX, gY, what, MEVE_NUM_DIG, want, MEVE_NUM_DIG, got);
+	}
+}
+
+/* The native code of MeveJitCompile() against MeveRun() and the postfix
+ * interpreter, bit for bit. */
+static size_t CheckJit(void)
+{
+#ifndef MEVE_JIT_NATIVE
+	printf("jit: skipped, no native code in this build\n");
+	return 0;
+#else
+	CHECK_STR s = { .seed = 0x4A17u };
+	size_t fails = 0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < CHECK_EXPRS; i++)
+	{
+		MEVE_PROGRAM prog;
+		MEVE_JIT jit;
+
+		CheckGen(&s);
+
+		if (CheckCompile(s.buff, &prog) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		if (MeveJitCompile(&prog, &jit) != MEVE_ERR_OK || !jit.fn)
+		{
+			CheckReport(&fails, "jit", s.buff, "not compiled", 0, 0);
+			MeveFree(&prog);
+			continue;
+		}
+
+		count++;
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			num_t run, eval, native;
+
+			CheckPoint(&s);
+			MeveRun(&prog, &run);
+			MeveJitRun(&jit, &native);
+			CheckEval(s.buff, &eval);
+
+			if (!CheckSame(run, native))
+			{
+				CheckReport(&fails, "jit", s.buff, "MeveJitRun() against MeveRun()", run, native);
+			}
+
+			if (!CheckSame(eval, native))
+			{
+				CheckReport(&fails, "jit", s.buff, "MeveJitRun() against EvalString()", eval, native);
+			}
+		}
+
+		MeveJitFree(&jit);
+		MeveFree(&prog);
+	}
+
+	printf("jit: %zu programs, %zu failures\n", count, fails);
+	return fails;
+#endif
+}
+
+/* Copies an expression with each number literal replaced by a random
+ * one, so that the copy has the same token shape. */
+static void CheckRelabel(
+	CHECK_STR* s,
+	const char* str,
+	CHECK_STR* out)
+{
+	static const char* const nums[] = { "0.5", "2", "3", "7", "1.5", "2.25", "5" };
+
+	out->len = 0;
+	out->buff[0] = '\0';
+
+	while (*str)
+	{
+		const bool start = isdigit((unsigned char)*str) &&
+			(out->len == 0 || !(isalnum((unsigned char)out->buff[out->len - 1]) || out->buff[out->len - 1] == '_'));
+
+		if (start)
+		{
+			CheckPut(out, nums[CheckRand(s, sizeof(nums) / sizeof(nums[0]))]);
+
+			while (isdigit((unsigned char)*str) || *str == '.')
+			{
+				str++;
+			}
+		}
+		else
+		{
+			const char c[2] = { *str++, '\0' };
+
+			CheckPut(out, c);
+		}
+	}
+}
+
+/* The programs of MeveCompile() with their repeated subexpressions
+ * shared, through MeveRun() and MeveRunBatch(), against the postfix
+ * interpreter, which evaluates every occurrence. */
+static size_t CheckShare(void)
+{
+	CHECK_STR s = { .seed = 0xC5Eu };
+	size_t fails = 0;
+	size_t shared = 0;
+
+	for (size_t i = 0; i < CHECK_EXPRS; i++)
+	{
+		num_t xs[CHECK_POINTS];
+		num_t ys[CHECK_POINTS];
+		num_t batch[CHECK_POINTS];
+		const num_t* cols[] = { xs, ys };
+		MEVE_PROGRAM prog;
+
+		CheckGen(&s);
+
+		if (CheckCompile(s.buff, &prog) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		shared += prog.tLen != 0;
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			CheckPoint(&s);
+			xs[k] = gX;
+			ys[k] = gY;
+		}
+
+		MeveRunBatch(&prog, cols, CHECK_POINTS, batch);
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			num_t run, eval;
+
+			gX = xs[k];
+			gY = ys[k];
+			MeveRun(&prog, &run);
+			CheckEval(s.buff, &eval);
+
+			if (!CheckSame(eval, run))
+			{
+				CheckReport(&fails, "share", s.buff, "MeveRun() against EvalString()", eval, run);
+			}
+
+			if (!CheckSame(eval, batch[k]))
+			{
+				CheckReport(&fails, "share", s.buff, "MeveRunBatch() against EvalString()", eval, batch[k]);
+			}
+		}
+
+		MeveFree(&prog);
+	}
+
+	/* The generated expressions repeat subexpressions on purpose. */
+	if (!shared)
+	{
+		printf("share: no program shared a subexpression\n");
+		fails++;
+	}
+
+	printf("share: %zu programs with temporaries, %zu failures\n", shared, fails);
+	return fails;
+}
+
+/* Evaluates an expression through a cache of token shapes. */
+static MeveCode CheckEvalShape(
+	MEVE_CACHE* cache,
+	const char* str,
+	num_t* res)
+{
+	MEVE_CONTEXT ctx;
+	MeveCode code;
+
+	MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), str);
+	MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+	code = MeveCacheEvalShape(cache, &ctx);
+	*res = ctx.ans;
+	return code;
+}
+
+/* The programs of MeveCompileParams() whose repeated subexpressions are
+ * shared, through MeveCacheEvalShape(), against the postfix interpreter.
+ * The parameters must keep their slots when the pool is compacted. */
+static size_t CheckShareParams(void)
+{
+	static const char* const fixed[] = { "3+(x*y)*(x*y)-7", "2*sin(x/4)+sin(x/4)^2", "(x+1.5)*(x+1.5)/8" };
+	CHECK_STR s = { .seed = 0x5EEDu };
+	MEVE_CACHE* cache;
+	size_t fails = 0;
+
+	if (MeveCacheCreate(&cache, CHECK_CACHESIZE) != MEVE_ERR_OK)
+	{
+		printf("share-params: cache not created\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < CHECK_EXPRS; i++)
+	{
+		const char* str = s.buff;
+
+		if (i < sizeof(fixed) / sizeof(fixed[0]))
+		{
+			str = fixed[i];
+		}
+		else
+		{
+			CheckGen(&s);
+		}
+
+		/* A new cache per expression, so that each one is compiled. */
+		MeveCacheClear(cache);
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			num_t eval, shape;
+
+			CheckPoint(&s);
+
+			if (CheckEval(str, &eval) != MEVE_ERR_OK)
+			{
+				break;
+			}
+
+			if (CheckEvalShape(cache, str, &shape) != MEVE_ERR_OK || !CheckSame(eval, shape))
+			{
+				CheckReport(&fails, "share-params", str, "MeveCacheEvalShape() against EvalString()", eval, shape);
+			}
+		}
+	}
+
+	MeveCacheFree(cache);
+	printf("share-params: %zu failures\n", fails);
+	return fails;
+}
+
+/* Expressions of the same shape with other literals, through the cache
+ * of token shapes: the first one compiles a program and the next ones
+ * must hit it with their own literals bound to the parameters. */
+static size_t CheckShapeRebind(void)
+{
+	CHECK_STR s = { .seed = 0xB1ADu };
+	MEVE_CACHE* cache;
+	size_t fails = 0;
+	size_t hits = 0;
+
+	if (MeveCacheCreate(&cache, CHECK_CACHESIZE) != MEVE_ERR_OK)
+	{
+		printf("shape: cache not created\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < CHECK_EXPRS / 4; i++)
+	{
+		CHECK_STR variant;
+		num_t eval, shape;
+		MEVE_CACHE_STATS before, after;
+
+		CheckGen(&s);
+		CheckPoint(&s);
+		MeveCacheClear(cache);
+
+		if (CheckEval(s.buff, &eval) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		CheckEvalShape(cache, s.buff, &shape);
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			CheckRelabel(&s, s.buff, &variant);
+			CheckPoint(&s);
+
+			if (CheckEval(variant.buff, &eval) != MEVE_ERR_OK)
+			{
+				continue;
+			}
+
+			MeveCacheStats(cache, &before);
+
+			if (CheckEvalShape(cache, variant.buff, &shape) != MEVE_ERR_OK || !CheckSame(eval, shape))
+			{
+				CheckReport(&fails, "shape", variant.buff, "MeveCacheEvalShape() against EvalString()", eval, shape);
+			}
+
+			MeveCacheStats(cache, &after);
+
+			if (after.hits != before.hits + 1)
+			{
+				CheckReport(&fails, "shape", variant.buff, "no cache hit", 0, 0);
+			}
+			hits++;
+		}
+	}
+
+	MeveCacheFree(cache);
+	printf("shape: %zu hits, %zu failures\n", hits, fails);
+	return fails;
+}
+
+/* A string that does not compile must leave the cache as it was: with a
+ * single entry, the program of a valid string is still hit afterwards. */
+static size_t CheckCacheFail(void)
+{
+	static const char* const bad[] = { "x+*y", "(x+1", "x+", "foo(x)" };
+	MeveCode(*const eval[])(MEVE_CACHE*, MEVE_CONTEXT*) = { MeveCacheEval, MeveCacheEvalShape };
+	const char* const good = "x*y+2";
+	size_t fails = 0;
+
+	for (size_t e = 0; e < sizeof(eval) / sizeof(eval[0]); e++)
+	{
+		MEVE_CACHE* cache;
+		MEVE_CACHE_STATS stats;
+		MEVE_CONTEXT ctx;
+
+		if (MeveCacheCreate(&cache, 1) != MEVE_ERR_OK)
+		{
+			printf("cache-fail: cache not created\n");
+			return 1;
+		}
+
+		MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), good);
+		MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+		eval[e](cache, &ctx);
+
+		for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+		{
+			MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), bad[i]);
+			MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+
+			if (eval[e](cache, &ctx) == MEVE_ERR_OK)
+			{
+				CheckReport(&fails, "cache-fail", bad[i], "invalid string evaluated", 0, ctx.ans);
+			}
+		}
+
+		MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), good);
+		MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+		eval[e](cache, &ctx);
+		MeveCacheStats(cache, &stats);
+
+		if (stats.evictions || stats.count != 1 || stats.hits != 1)
+		{
+			printf("cache-fail: %zu evictions, %zu entries, %zu hits after invalid strings\n",
+				(size_t)stats.evictions, (size_t)stats.count, (size_t)stats.hits);
+			fails++;
+		}
+
+		MeveCacheFree(cache);
+	}
+
+	printf("cache-fail: %zu failures\n", fails);
+	return fails;
+}
+
+/* Sets the box to random ranges of [-7, 7], some of them single points,
+ * and the variables to its lower bound. */
+static void CheckBox(
+	CHECK_STR* s,
+	MEVE_INTERVAL* box)
+{
+	static const num_t halves[] = { 0, (num_t)0.001, (num_t)0.25, 1, 3 };
+	num_t* const vals[] = { &gX, &gY };
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		const num_t mid = (num_t)CheckRand(s, 8001) / 1000 - 4;
+		const num_t half = halves[CheckRand(s, sizeof(halves) / sizeof(halves[0]))];
+
+		box[i].lo = mid - half;
+		box[i].hi = mid + half;
+		box[i].nan = 0;
+		*vals[i] = box[i].lo;
+	}
+}
+
+/* Moves the variables to another point of the box. */
+static void CheckBoxPoint(
+	CHECK_STR* s,
+	const MEVE_INTERVAL* box)
+{
+	num_t* const vals[] = { &gX, &gY };
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		const uint32_t u = CheckRand(s, 1003);
+
+		*vals[i] = u > 1000 ? box[i].hi : box[i].lo + (box[i].hi - box[i].lo) * (num_t)u / 1000;
+
+		if (*vals[i] > box[i].hi)
+		{
+			*vals[i] = box[i].hi;
+		}
+	}
+}
+
+/* MeveRunInterval() against MeveRun() at points of random boxes: every
+ * result that is a number must lie in the bounds, and a NaN result must
+ * have set the nan flag. */
+static size_t CheckInterval(void)
+{
+	static const char* const fixed[] =
+	{
+		"x^y", "x^3", "x^-2", "y^0.5", "(x*y)^(x-1)", "2^x",
+		"x mod y", "(x*y) mod 3", "7 mod x", "x mod 0.5",
+		"tan(x)", "tan(x*y)", "sin(x*y)", "cos(x)+sin(y)", "sin(3*x)*cos(y/2)",
+		"x choose y", "(x+5) choose 3", "7 choose x", "(x*y) choose (y+2)",
+		"x!", "(x+y)!", "abs(x*y)!", "(x+4)!/(y+4)!",
+	};
+	static const char* const divs[] = { "0.1", "0.3", "0.7", "1.1" };
+	CHECK_STR s = { .seed = 0x1BA1u };
+	size_t fails = 0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < CHECK_EXPRS; i++)
+	{
+		const char* str = s.buff;
+		MEVE_PROGRAM prog;
+
+		if (i < sizeof(fixed) / sizeof(fixed[0]))
+		{
+			str = fixed[i];
+		}
+		else
+		{
+			CheckGen(&s);
+		}
+
+		if (CheckCompile(str, &prog) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		for (size_t b = 0; b < CHECK_BOXES; b++)
+		{
+			MEVE_INTERVAL box[2];
+			MEVE_INTERVAL res;
+
+			CheckBox(&s, box);
+
+			if (MeveRunInterval(&prog, box, &res) != MEVE_ERR_OK)
+			{
+				CheckReport(&fails, "interval", str, "not bounded", 0, 0);
+				continue;
+			}
+
+			for (size_t k = 0; k < CHECK_POINTS; k++)
+			{
+				num_t run;
+
+				MeveRun(&prog, &run);
+				count++;
+
+				if (isnan(run) ? !res.nan : !(run >= res.lo && run <= res.hi))
+				{
+					CheckReport(&fails, "interval", str, isnan(run) ? "NaN without the nan flag" :
+						run < res.lo ? "below the lower bound" : "above the upper bound",
+						run < res.lo ? res.lo : res.hi, run);
+				}
+
+				CheckBoxPoint(&s, box);
+			}
+		}
+
+		MeveFree(&prog);
+	}
+
+	/* Boxes a few ulps wide next to a multiple of a divisor that is not a
+	 * binary fraction, where the rounded quotients can miss the multiple. */
+	for (size_t d = 0; d < sizeof(divs) / sizeof(divs[0]); d++)
+	{
+		MEVE_PROGRAM prog;
+		char str[32];
+		const num_t div = MEVE_STRTONUM(divs[d], NULL);
+
+		snprintf(str, sizeof(str), "x mod %s", divs[d]);
+
+		if (CheckCompile(str, &prog) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "interval", str, "not compiled", 0, 0);
+			continue;
+		}
+
+		for (int k = -CHECK_MULTIPLES; k <= CHECK_MULTIPLES; k++)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				MEVE_INTERVAL box[2] = { { (num_t)k * div, (num_t)k * div, 0 }, { 0, 0, 0 } };
+				MEVE_INTERVAL res;
+
+				for (size_t u = 0; u < CHECK_ULPS; u++)
+				{
+					if (side < 0)
+					{
+						box[0].lo = MEVE_MATH(nextafter)(box[0].lo, -INFINITY);
+					}
+					else
+					{
+						box[0].hi = MEVE_MATH(nextafter)(box[0].hi, INFINITY);
+					}
+				}
+
+				MeveRunInterval(&prog, box, &res);
+
+				for (gX = box[0].lo; gX <= box[0].hi; gX = MEVE_MATH(nextafter)(gX, INFINITY))
+				{
+					num_t run;
+
+					MeveRun(&prog, &run);
+					count++;
+
+					if (!(run >= res.lo && run <= res.hi))
+					{
+						CheckReport(&fails, "interval", str, run < res.lo ? "below the lower bound" : "above the upper bound",
+							run < res.lo ? res.lo : res.hi, run);
+					}
+				}
+			}
+		}
+
+		MeveFree(&prog);
+	}
+
+	printf("interval: %zu points, %zu failures\n", count, fails);
+	return fails;
+}
+
+/* Callbacks without an operation code, which MeveRunGrad() can only
+ * differentiate by central differences. */
+static num_t CheckCube(
+	const num_t* arg)
+{
+	return arg[0] * arg[0] * arg[0];
+}
+
+static num_t CheckSinProd(
+	const num_t* arg)
+{
+	return arg[0] * MEVE_MATH(sin)(arg[1]);
+}
+
+/* Central difference of a program with respect to one variable, or NaN
+ * when the one-sided differences disagree, as next to a kink of abs(),
+ * mod, min or max, or when the program is not finite around the point. */
+static num_t CheckDiff(
+	const MEVE_PROGRAM* prog,
+	num_t* var)
+{
+	const num_t x = *var;
+	const num_t h = MEVE_MATH(cbrt)(MEVE_NUM_EPSILON) * MEVE_MATH(fmax)(1, MEVE_MATH(fabs)(x));
+	num_t lo, mid, hi, fwd, bwd;
+
+	*var = x - h;
+	MeveRun(prog, &lo);
+	*var = x + h;
+	MeveRun(prog, &hi);
+	*var = x;
+	MeveRun(prog, &mid);
+
+	fwd = (hi - mid) / h;
+	bwd = (mid - lo) / h;
+
+	if (!isfinite(fwd) || !isfinite(bwd) || MEVE_MATH(fabs)(fwd - bwd) > (num_t)0.1 * (1 + MEVE_MATH(fabs)(fwd + bwd)))
+	{
+		return NAN;
+	}
+	return (hi - lo) / (2 * h);
+}
+
+/* Compares the derivatives of MeveRunGrad() with respect to every
+ * variable with central differences, counting the ones compared. */
+static void CheckGradPoint(
+	size_t* fails,
+	size_t* count,
+	const char* str,
+	const MEVE_PROGRAM* prog,
+	num_t* const* vals)
+{
+	/* Central differences are accurate to about the square of the step. */
+	const num_t step = MEVE_MATH(cbrt)(MEVE_NUM_EPSILON);
+	const num_t tol = 1024 * step * step;
+	num_t grad[CHECK_WIDEVARS];
+	num_t res, run;
+
+	if (MeveRunGrad(prog, NULL, 0, &res, grad) != MEVE_ERR_OK)
+	{
+		CheckReport(fails, "grad", str, "MeveRunGrad() failed", 0, 0);
+		return;
+	}
+
+	MeveRun(prog, &run);
+
+	if (!CheckSame(run, res))
+	{
+		CheckReport(fails, "grad", str, "value against MeveRun()", run, res);
+	}
+
+	for (size_t i = 0; i < prog->varCount; i++)
+	{
+		const num_t diff = CheckDiff(prog, vals[i]);
+
+		if (isnan(diff))
+		{
+			continue;
+		}
+
+		(*count)++;
+
+		if (!(MEVE_MATH(fabs)(grad[i] - diff) <= tol * (1 + MEVE_MATH(fabs)(diff) + MEVE_MATH(fabs)(res))))
+		{
+			CheckReport(fails, "grad", str, i ? "d/dy against central differences" : "d/dx against central differences", diff, grad[i]);
+		}
+	}
+}
+
+/* The gradients of MeveRunGrad() against central differences for every
+ * operation code, against the full gradient for a subset of variables,
+ * and for a program whose dual stack does not fit the local buffer. */
+static size_t CheckGrad(void)
+{
+	static const char* const fixed[] =
+	{
+		"x+y", "x-y", "-x*y", "+x/y", "x*y", "x/y", "x mod 0.7", "y mod x",
+		"x choose y", "(x+3) choose y", "(x*y+1)!", "x!", "min(x,y)", "max(x*x,y)",
+		"abs(x-y)", "x^y", "y^x", "x^3", "2^x", "x^-2", "exp(x/2)", "sqrt(x*y)",
+		"sin(x)*cos(y)", "tan(x/2)", "arcsin(x/3)", "arccos(y/3)", "arctan(x*y)",
+		"log10(x+y)", "log(x)*y", "sin(x*y)+sin(x*y)^2", "(x+y)*(x+y)/(x+y+1)",
+	};
+	static num_t(*calls[])(const num_t*) = { &CheckCube, &CheckSinProd };
+	static const uint8_t callOps[] = { MEVE_OP_LOADV, MEVE_OP_CALL1, MEVE_OP_LOADV, MEVE_OP_CALL2, MEVE_OP_RET };
+	static const uint16_t callArgs[] = { 0, 0, 1, 1 };
+	const MEVE_PROGRAM call =
+	{
+		.ops = (uint8_t*)callOps, .len = sizeof(callOps), .args = (uint16_t*)callArgs, .aLen = 4,
+		.fPool = calls, .fLen = 2, .depth = 2, .vars = gVars, .varCount = 2
+	};
+	num_t* const vals[] = { &gX, &gY };
+	CHECK_STR s = { .seed = 0x6AD1u };
+	CHECK_STR wide = { .seed = 0 };
+	MEVE_PROGRAM prog;
+	size_t fails = 0;
+	size_t count = 0;
+
+	for (size_t i = 0; i <= sizeof(fixed) / sizeof(fixed[0]); i++)
+	{
+		const bool isCall = i == sizeof(fixed) / sizeof(fixed[0]);
+		const char* str = isCall ? "CALL2(CALL1(x), y)" : fixed[i];
+
+		if (!isCall && CheckCompile(str, &prog) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "grad", str, "not compiled", 0, 0);
+			continue;
+		}
+
+		for (size_t k = 0; k < CHECK_POINTS; k++)
+		{
+			const size_t wrt[] = { 1, 0 };
+			num_t full[2], part[2];
+			num_t res;
+
+			/* Away from 0, where most of the functions have a pole. */
+			gX = (num_t)CheckRand(&s, 1801) / 1000 + (num_t)0.6;
+			gY = (num_t)CheckRand(&s, 1801) / 1000 + (num_t)0.6;
+			CheckGradPoint(&fails, &count, str, isCall ? &call : &prog, vals);
+
+			/* A subset of the variables, in another order, is the same
+			 * arithmetic on fewer derivatives. */
+			MeveRunGrad(isCall ? &call : &prog, NULL, 0, &res, full);
+			MeveRunGrad(isCall ? &call : &prog, wrt, 2, &res, part);
+
+			if (!CheckSame(full[0], part[1]) || !CheckSame(full[1], part[0]))
+			{
+				CheckReport(&fails, "grad", str, "wrt subset against the full gradient", full[0], part[1]);
+			}
+
+			MeveRunGrad(isCall ? &call : &prog, wrt, 1, &res, part);
+
+			if (!CheckSame(full[1], part[0]))
+			{
+				CheckReport(&fails, "grad", str, "single wrt against the full gradient", full[1], part[0]);
+			}
+		}
+
+		if (!isCall)
+		{
+			MeveFree(&prog);
+		}
+	}
+
+	/* A nested expression of many variables: its depth times the number
+	 * of derivatives is larger than MAXLEN_TBUFFER. */
+	for (size_t i = 0; i < CHECK_WIDEVARS; i++)
+	{
+		char term[32];
+
+		snprintf(gWideNames[i], sizeof(gWideNames[i]), "v%zu", i);
+		gWideVars[i].str = gWideNames[i];
+		gWideVars[i].ptr = &gWide[i];
+		snprintf(term, sizeof(term), i % 2 ? "%s+sin(" : "%s*(", gWideNames[i]);
+		CheckPut(&wide, i + 1 < CHECK_WIDEVARS ? term : gWideNames[i]);
+	}
+
+	for (size_t i = 0; i + 1 < CHECK_WIDEVARS; i++)
+	{
+		CheckPut(&wide, ")");
+	}
+
+	if (CheckCompileVars(wide.buff, gWideVars, CHECK_WIDEVARS, &prog) != MEVE_ERR_OK)
+	{
+		CheckReport(&fails, "grad", "wide program", "not compiled", 0, 0);
+	}
+	else
+	{
+		num_t* wideVals[CHECK_WIDEVARS];
+		num_t full[CHECK_WIDEVARS], part[2];
+		const size_t wrt[] = { CHECK_WIDEVARS - 1, 0 };
+		num_t res;
+
+		if ((prog.depth + prog.tLen) * (CHECK_WIDEVARS + 1) <= MAXLEN_TBUFFER)
+		{
+			CheckReport(&fails, "grad", "wide program", "fits the stack buffer", 0, 0);
+		}
+
+		for (size_t i = 0; i < CHECK_WIDEVARS; i++)
+		{
+			wideVals[i] = &gWide[i];
+			gWide[i] = (num_t)CheckRand(&s, 1001) / 1000 + (num_t)0.5;
+		}
+
+		CheckGradPoint(&fails, &count, "wide program", &prog, wideVals);
+
+		/* Two derivatives fit the stack buffer and must not change. */
+		MeveRunGrad(&prog, NULL, 0, &res, full);
+		MeveRunGrad(&prog, wrt, 2, &res, part);
+
+		if (!CheckSame(full[CHECK_WIDEVARS - 1], part[0]) || !CheckSame(full[0], part[1]))
+		{
+			CheckReport(&fails, "grad", "wide program", "wrt subset against the full gradient", full[0], part[1]);
+		}
+
+		MeveFree(&prog);
+	}
+
+	printf("grad: %zu derivatives, %zu failures\n", count, fails);
+	return fails;
+}
+
+/* MeveIncrRun() against MeveRun(), bit for bit, over ticks that change
+ * none, one or both variables, often to values seen before so that some
+ * entries keep their value. The generated programs share subexpressions,
+ * whose temporaries link the entries through MEVE_OP_STORE and
+ * MEVE_OP_LOADT. */
+static size_t CheckIncr(void)
+{
+	CHECK_STR s = { .seed = 0x12C3u };
+	size_t fails = 0;
+	size_t shared = 0;
+	size_t evals = 0;
+	size_t entries = 0;
+
+	for (size_t i = 0; i < CHECK_EXPRS; i++)
+	{
+		MEVE_PROGRAM prog;
+		MEVE_INCR inc;
+
+		CheckGen(&s);
+
+		if (CheckCompile(s.buff, &prog) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		if (MeveIncrInit(&prog, &inc) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "incr", s.buff, "not prepared", 0, 0);
+			MeveFree(&prog);
+			continue;
+		}
+
+		shared += prog.tLen != 0;
+		CheckPoint(&s);
+
+		for (size_t t = 0; t < CHECK_TICKS; t++)
+		{
+			num_t run, incr;
+
+			switch (CheckRand(&s, 4))
+			{
+				case 0:
+				{
+					gX = (num_t)CheckRand(&s, 17) / 2 - 4;
+					break;
+				}
+				case 1:
+				{
+					gY = (num_t)CheckRand(&s, 17) / 2 - 4;
+					break;
+				}
+				case 2:
+				{
+					CheckPoint(&s);
+					break;
+				}
+			}
+
+			MeveRun(&prog, &run);
+
+			if (MeveIncrRun(&inc, &incr) != MEVE_ERR_OK || !CheckSame(run, incr))
+			{
+				CheckReport(&fails, "incr", s.buff, "MeveIncrRun() against MeveRun()", run, incr);
+			}
+
+			evals += inc.count;
+			entries += prog.len;
+		}
+
+		MeveIncrFree(&inc);
+		MeveFree(&prog);
+	}
+
+	if (!shared)
+	{
+		printf("incr: no program shared a subexpression\n");
+		fails++;
+	}
+
+	printf("incr: %zu programs with temporaries, %zu of %zu entries evaluated, %zu failures\n",
+		shared, evals, entries, fails);
+	return fails;
+}
+
+/* Allocates a block aligned to MEVE_IMAGE_ALIGN. */
+static uint8_t* CheckImageAlloc(
+	const size_t sz)
+{
+	return aligned_alloc(MEVE_IMAGE_ALIGN, (sz + MEVE_IMAGE_ALIGN - 1) & ~(size_t)(MEVE_IMAGE_ALIGN - 1));
+}
+
+/* Writes programs to an image in a buffer aligned to MEVE_IMAGE_ALIGN,
+ * which is NULL when writing fails. */
+static uint8_t* CheckImageWrite(
+	const MEVE_PROGRAM* const* progs,
+	const size_t count,
+	size_t* sz)
+{
+	uint8_t* buff;
+
+	if (MeveImageWrite(progs, count, NULL, sz) != MEVE_ERR_OK ||
+		!(buff = CheckImageAlloc(*sz)))
+	{
+		return NULL;
+	}
+
+	if (MeveImageWrite(progs, count, buff, sz) != MEVE_ERR_OK)
+	{
+		free(buff);
+		return NULL;
+	}
+	return buff;
+}
+
+/* Whether opening an image, and retrieving its first program, fails with
+ * MEVE_ERR_INVALIDEXPR. */
+static bool CheckImageRejected(
+	const uint8_t* data,
+	const size_t sz)
+{
+	MEVE_IMAGE img;
+	MEVE_PROGRAM prog;
+	MeveCode res = MeveImageOpen(&img, data, sz, gVars, sizeof(gVars) / sizeof(gVars[0]));
+
+	if (res == MEVE_ERR_OK)
+	{
+		res = MeveImageProgram(&img, 0, &prog);
+	}
+
+	MeveImageClose(&img);
+	return res == MEVE_ERR_INVALIDEXPR;
+}
+
+/* Programs written to an image, opened and run again bit for bit, and
+ * damaged images, which must be rejected as invalid. */
+static size_t CheckImage(void)
+{
+	/* Hand-built programs whose operands the writer copies unchecked. */
+	static const uint8_t pushOps[] = { MEVE_OP_PUSHK, MEVE_OP_RET };
+	static const uint16_t pushArgs[] = { 1 };
+	static const uint8_t loadOps[] = { MEVE_OP_LOADV, MEVE_OP_RET };
+	static const uint16_t loadArgs[] = { 2 };
+	static const uint8_t tempOps[] = { MEVE_OP_LOADV, MEVE_OP_STORE, MEVE_OP_LOADT, MEVE_OP_ADD, MEVE_OP_RET };
+	static const uint16_t tempArgs[] = { 0, 0, 1 };
+	static const uint8_t underOps[] = { MEVE_OP_LOADV, MEVE_OP_ADD, MEVE_OP_RET };
+	static const uint16_t underArgs[] = { 0 };
+	static num_t k[] = { 2 };
+	const MEVE_PROGRAM bad[] =
+	{
+		{ .ops = (uint8_t*)pushOps, .len = 1, .args = (uint16_t*)pushArgs, .aLen = 1, .kPool = k, .kLen = 1, .depth = 1 },
+		{ .ops = (uint8_t*)loadOps, .len = 1, .args = (uint16_t*)loadArgs, .aLen = 1, .depth = 1, .vars = gVars, .varCount = 2 },
+		{ .ops = (uint8_t*)tempOps, .len = 4, .args = (uint16_t*)tempArgs, .aLen = 3, .depth = 2, .tLen = 1, .vars = gVars, .varCount = 2 },
+		{ .ops = (uint8_t*)underOps, .len = 2, .args = (uint16_t*)underArgs, .aLen = 1, .depth = 2, .vars = gVars, .varCount = 2 },
+	};
+	static const char* const badNames[] = { "PUSHK out of the pool", "LOADV out of the table", "LOADT out of the slots", "stack underflow" };
+	CHECK_STR s = { .seed = 0x1AA6u };
+	MEVE_PROGRAM progs[CHECK_IMAGEPROGS];
+	const MEVE_PROGRAM* ptrs[CHECK_IMAGEPROGS];
+	static char strs[CHECK_IMAGEPROGS][CHECK_MAXLEN_EXPR];
+	size_t fails = 0;
+	size_t count = 0;
+	MEVE_IMAGE img;
+	uint8_t* data;
+	uint8_t* copy;
+	size_t sz;
+
+	while (count < CHECK_IMAGEPROGS)
+	{
+		CheckGen(&s);
+
+		if (CheckCompile(s.buff, &progs[count]) == MEVE_ERR_OK)
+		{
+			memcpy(strs[count], s.buff, s.len + 1);
+			ptrs[count] = &progs[count];
+			count++;
+		}
+	}
+
+	if (!(data = CheckImageWrite(ptrs, count, &sz)) || !(copy = CheckImageAlloc(sz)))
+	{
+		printf("image: not written\n");
+		free(data);
+		return 1;
+	}
+
+	if (MeveImageOpen(&img, data, sz, gVars, sizeof(gVars) / sizeof(gVars[0])) != MEVE_ERR_OK || img.count != count)
+	{
+		CheckReport(&fails, "image", "image", "not opened", 0, 0);
+	}
+
+	for (size_t i = 0; i < img.count; i++)
+	{
+		MEVE_PROGRAM prog;
+
+		if (MeveImageProgram(&img, i, &prog) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "image", strs[i], "program not retrieved", 0, 0);
+			continue;
+		}
+
+		for (size_t p = 0; p < CHECK_POINTS; p++)
+		{
+			num_t want, got;
+
+			CheckPoint(&s);
+			MeveRun(&progs[i], &want);
+			MeveRun(&prog, &got);
+
+			if (!CheckSame(want, got))
+			{
+				CheckReport(&fails, "image", strs[i], "image program against the original", want, got);
+			}
+		}
+	}
+
+	MeveImageClose(&img);
+
+	/* Truncated images, before and after the end of the header. */
+	if (!CheckImageRejected(data, sz - 1) || !CheckImageRejected(data, 8))
+	{
+		CheckReport(&fails, "image", "image", "truncated image accepted", 0, 0);
+	}
+
+	memcpy(copy, data, sz);
+	copy[CHECK_IMAGE_VERSION]++;
+
+	if (!CheckImageRejected(copy, sz))
+	{
+		CheckReport(&fails, "image", "image", "other version accepted", 0, 0);
+	}
+
+	memcpy(copy, data, sz);
+	copy[CHECK_IMAGE_NUMSIZE] = copy[CHECK_IMAGE_NUMSIZE] == sizeof(double) ? sizeof(float) : sizeof(double);
+
+	if (!CheckImageRejected(copy, sz))
+	{
+		CheckReport(&fails, "image", "image", "other size of num_t accepted", 0, 0);
+	}
+
+	free(copy);
+	free(data);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		MeveFree(&progs[i]);
+	}
+
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+	{
+		const MEVE_PROGRAM* ptr = &bad[i];
+
+		if (!(data = CheckImageWrite(&ptr, 1, &sz)))
+		{
+			CheckReport(&fails, "image", badNames[i], "not written", 0, 0);
+			continue;
+		}
+
+		if (!CheckImageRejected(data, sz))
+		{
+			CheckReport(&fails, "image", badNames[i], "damaged program accepted", 0, 0);
+		}
+		free(data);
+	}
+
+	printf("image: %zu programs, %zu failures\n", count, fails);
+	return fails;
+}
+
+/* The rewrites of MEVE_FLAG_FASTMATH against the postfix interpreter,
+ * within a few ulps, or a few subnormal steps for the tiny results. The
+ * points include bases whose positive powers overflow while the negative
+ * ones are still numbers. */
+static size_t CheckFastMath(void)
+{
+	static const char* const fixed[] =
+	{
+		"x^0.5", "x^2", "x^3", "x^4", "x^5", "x^7", "x^8", "x^11", "x^16",
+		"x^-1", "x^-2", "x^-3", "x^-5", "x^-8", "x^-16", "(x*y)^-4+y^3",
+		"x/3", "x/7", "(x+y)/0.1", "x/2-y/10", "sin(x/5)^2+cos(y/3)^-2",
+	};
+	const num_t sub = MEVE_MATH(nextafter)(0, 1);
+	const num_t max = MEVE_MATH(nextafter)(INFINITY, 0);
+	const num_t big = 2 * MEVE_MATH(sqrt)(max);
+	const num_t extremes[] = { big, -big, 1 / big, max, -max, MEVE_MATH(ldexp)(sub, MEVE_NUM_MANT_DIG - 1), 0 };
+	CHECK_STR s = { .seed = 0xFA57u };
+	size_t fails = 0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++)
+	{
+		MEVE_CONTEXT ctx;
+		MEVE_PROGRAM prog;
+
+		MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), fixed[i]);
+		MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+		MeveSetFlags(&ctx, MEVE_FLAG_FASTMATH);
+
+		if (MeveCompile(&ctx, &prog) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "fastmath", fixed[i], "not compiled", 0, 0);
+			continue;
+		}
+
+		for (size_t k = 0; k < CHECK_POINTS + sizeof(extremes) / sizeof(extremes[0]); k++)
+		{
+			num_t eval, run;
+
+			CheckPoint(&s);
+
+			if (k >= CHECK_POINTS)
+			{
+				gX = extremes[k - CHECK_POINTS];
+				gY = 1;
+			}
+
+			CheckEval(fixed[i], &eval);
+			MeveRun(&prog, &run);
+			count++;
+
+			if (!CheckSame(eval, run) && !(MEVE_MATH(fabs)(eval - run) <=
+				CHECK_FASTULPS * (MEVE_NUM_EPSILON * MEVE_MATH(fabs)(eval) + sub)))
+			{
+				CheckReport(&fails, "fastmath", fixed[i], "MeveRun() against EvalString()", eval, run);
+			}
+		}
+
+		MeveFree(&prog);
+	}
+
+	printf("fastmath: %zu points, %zu failures\n", count, fails);
+	return fails;
+}
+
+/* Evaluates a numeric expression, printed with a format. */
+static num_t CheckEvalf(
+	const char* fmt,
+	const num_t a,
+	const num_t b,
+	char* str,
+	const size_t sz)
+{
+	num_t res;
+
+	snprintf(str, sz, fmt, (double)a, (double)b);
+	CheckEval(str, &res);
+	return res;
+}
+
+/* Whether a result is within tol of a reference, relative to it, with
+ * infinities only matching themselves. */
+static bool CheckNear(
+	const num_t want,
+	const num_t got,
+	const num_t tol)
+{
+	return CheckSame(want, got) || (isfinite(want) && MEVE_MATH(fabs)(got - want) <= tol * MEVE_MATH(fabs)(want));
+}
+
+/* The choose and factorial operators against exact binomial coefficients,
+ * the gamma function at the ends of the table of factorials, and the
+ * log-gamma path for non-integers and for large k. */
+static size_t CheckChoose(void)
+{
+	/* The first and last factorials that are finite in each precision. */
+	static const int facts[] = { 33, 34, 35, 36, 169, 170, 171, 172, 1753, 1754, 1755, 1756 };
+	static const num_t nonInt[] = { 0.5, 2.5, 10.25, 33.75, 169.5 };
+	static const num_t logs[][2] = { { 7.5, 2.5 }, { 10, 0.5 }, { 40.25, 20 }, { 2100, 1050 }, { 3000, 1500 }, { 3000, 1030 }, { 1e6, 1030 } };
+	static uint64_t pascal[CHECK_CHOOSE_MAXN + 1][CHECK_CHOOSE_MAXN + 1];
+	const num_t exact = MEVE_MATH(ldexp)(1, MEVE_NUM_MANT_DIG);
+	char str[64];
+	size_t fails = 0;
+	size_t count = 0;
+
+	for (int n = 0; n <= CHECK_CHOOSE_MAXN; n++)
+	{
+		pascal[n][0] = pascal[n][n] = 1;
+
+		for (int k = 1; k < n; k++)
+		{
+			pascal[n][k] = pascal[n - 1][k - 1] + pascal[n - 1][k];
+		}
+
+		/* Results that fit the mantissa are exact, the others rounded from
+		 * a few operations. */
+		for (int k = 0; k <= n; k++)
+		{
+			const num_t want = (num_t)pascal[n][k];
+			const num_t got = CheckEvalf("%.0f choose %.0f", n, k, str, sizeof(str));
+
+			count++;
+
+			if (want < exact ? !CheckSame(want, got) : !CheckNear(want, got, 4 * MEVE_NUM_EPSILON))
+			{
+				CheckReport(&fails, "choose", str, "against Pascal's triangle", want, got);
+			}
+		}
+	}
+
+	/* Each factorial of the table is the previous one times its index,
+	 * rounded once per step. */
+	for (size_t i = 0; i < sizeof(facts) / sizeof(facts[0]); i++)
+	{
+		const num_t want = MEVE_MATH(tgamma)((num_t)facts[i] + 1);
+		const num_t got = CheckEvalf("%.0f!", facts[i], 0, str, sizeof(str));
+
+		count++;
+
+		if (!CheckNear(want, got, facts[i] * MEVE_NUM_EPSILON))
+		{
+			CheckReport(&fails, "choose", str, "against tgamma()", want, got);
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(nonInt) / sizeof(nonInt[0]); i++)
+	{
+		const num_t want = MEVE_MATH(tgamma)(nonInt[i] + 1);
+		const num_t got = CheckEvalf("%g!", nonInt[i], 0, str, sizeof(str));
+
+		count++;
+
+		if (!CheckNear(want, got, 4 * MEVE_NUM_EPSILON))
+		{
+			CheckReport(&fails, "choose", str, "against tgamma()", want, got);
+		}
+	}
+
+	/* The logarithms lose about their magnitude in ulps. */
+	for (size_t i = 0; i < sizeof(logs) / sizeof(logs[0]); i++)
+	{
+		const num_t n = logs[i][0];
+		const num_t k = logs[i][1];
+		const num_t lg = MEVE_MATH(lgamma)(n + 1);
+		const num_t want = MEVE_MATH(exp)(lg - MEVE_MATH(lgamma)(k + 1) - MEVE_MATH(lgamma)(n - k + 1));
+		const num_t got = CheckEvalf("%g choose %g", n, k, str, sizeof(str));
+
+		count++;
+
+		if (!CheckNear(want, got, 16 * MEVE_NUM_EPSILON * (1 + lg)))
+		{
+			CheckReport(&fails, "choose", str, "against lgamma()", want, got);
+		}
+
+		/* Both sides of a large k take the same path. */
+		if (n == MEVE_MATH(floor)(n) && k == MEVE_MATH(floor)(k) && !CheckSame(got, CheckEvalf("%g choose %g", n, n - k, str, sizeof(str))))
+		{
+			CheckReport(&fails, "choose", str, "not symmetric", got, CheckEvalf("%g choose %g", n, n - k, str, sizeof(str)));
+		}
+	}
+
+	printf("choose: %zu values, %zu failures\n", count, fails);
+	return fails;
+}
+
+/* MevePoolEval() against EvalString() and MevePoolRunBatch() against
+ * MeveRunBatch() on a pool of several threads. */
+static size_t CheckPool(void)
+{
+	static const size_t rowCounts[] = { CHECK_POOL_ROWS, MEVE_POOL_ROWS + 1, 3 };
+	CHECK_STR s = { .seed = 0x9001u };
+	CHECK_STR* exprs = malloc(CHECK_POOL_EXPRS * sizeof(CHECK_STR));
+	const char** strs = malloc(CHECK_POOL_EXPRS * sizeof(char*));
+	num_t* res = malloc(CHECK_POOL_EXPRS * sizeof(num_t));
+	MeveCode* codes = malloc(CHECK_POOL_EXPRS * sizeof(MeveCode));
+	MEVE_POOL* pool = NULL;
+	size_t fails = 0;
+	size_t evals = 0;
+	size_t rows = 0;
+
+	if (!exprs || !strs || !res || !codes || MevePoolCreate(&pool, CHECK_POOL_THREADS) != MEVE_ERR_OK)
+	{
+		printf("pool: not created\n");
+		free(exprs);
+		free(strs);
+		free(res);
+		free(codes);
+		return 1;
+	}
+
+	/* Every few expressions are invalid or missing, so failures are
+	 * reported in place too. */
+	for (size_t i = 0; i < CHECK_POOL_EXPRS; i++)
+	{
+		CheckGen(&s);
+		exprs[i] = s;
+		strs[i] = i % 37 == 5 ? NULL : i % 29 == 3 ? "x+" : exprs[i].buff;
+	}
+
+	/* The second round reuses the threads of the first. */
+	for (size_t round = 0; round < 2; round++)
+	{
+		CheckPoint(&s);
+
+		if (MevePoolEval(pool, strs, CHECK_POOL_EXPRS, gVars, sizeof(gVars) / sizeof(gVars[0]), res, codes) != MEVE_ERR_OK)
+		{
+			CheckReport(&fails, "pool", "", "MevePoolEval() failed", 0, 0);
+			continue;
+		}
+
+		for (size_t i = 0; i < CHECK_POOL_EXPRS; i++)
+		{
+			num_t want = 0;
+			const MeveCode code = strs[i] ? CheckEval(strs[i], &want) : MEVE_ERR_INVALIDPARAM;
+
+			evals++;
+
+			if (code != codes[i] || (code == MEVE_ERR_OK && !CheckSame(want, res[i])))
+			{
+				CheckReport(&fails, "pool", strs[i] ? strs[i] : "(null)", "MevePoolEval() against EvalString()", want, res[i]);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < CHECK_POOL_ROWS; i++)
+	{
+		CheckPoint(&s);
+		gPoolCols[0][i] = gX;
+		gPoolCols[1][i] = gY;
+	}
+
+	for (size_t i = 0; i < CHECK_POOL_PROGS; i++)
+	{
+		const num_t* const cols[] = { gPoolCols[0], gPoolCols[1] };
+		MEVE_PROGRAM prog;
+
+		CheckGen(&s);
+
+		if (CheckCompile(s.buff, &prog) != MEVE_ERR_OK)
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < sizeof(rowCounts) / sizeof(rowCounts[0]); j++)
+		{
+			const MeveCode want = MeveRunBatch(&prog, cols, rowCounts[j], gPoolWant);
+			const MeveCode got = MevePoolRunBatch(pool, &prog, cols, rowCounts[j], gPoolGot);
+
+			if (want != got)
+			{
+				CheckReport(&fails, "pool", s.buff, "MevePoolRunBatch() code against MeveRunBatch()", want, got);
+				continue;
+			}
+
+			for (size_t r = 0; r < rowCounts[j] && want == MEVE_ERR_OK; r++)
+			{
+				if (!CheckSame(gPoolWant[r], gPoolGot[r]))
+				{
+					gX = gPoolCols[0][r];
+					gY = gPoolCols[1][r];
+					CheckReport(&fails, "pool", s.buff, "MevePoolRunBatch() against MeveRunBatch()", gPoolWant[r], gPoolGot[r]);
+				}
+			}
+			rows += rowCounts[j];
+		}
+
+		MeveFree(&prog);
+	}
+
+	MevePoolFree(pool);
+	free(exprs);
+	free(strs);
+	free(res);
+	free(codes);
+	printf("pool: %d threads, %zu expressions, %zu rows, %zu failures\n", CHECK_POOL_THREADS, evals, rows, fails);
+	return fails;
+}
+
+/* Allocates an arena block, counting the blocks in use. */
+static void* CheckArenaAlloc(
+	void* user,
+	size_t sz)
+{
+	++*(size_t*)user;
+	return malloc(sz);
+}
+
+static void CheckArenaFree(
+	void* user,
+	void* block)
+{
+	--*(size_t*)user;
+	free(block);
+}
+
+/* Appends a term repeated count times. */
+static void CheckPutRepeat(
+	CHECK_STR* s,
+	const char* term,
+	const size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		CheckPut(s, term);
+	}
+}
+
+/* Expressions longer than the fixed buffers, evaluated on a context of
+ * MAXLEN_TBUFFER tokens backed by an arena, against a context with a
+ * large static buffer. Every expression is evaluated again after
+ * MeveUpdate(), and after MeveArenaReset(), on the same blocks. */
+static size_t CheckArena(void)
+{
+	static MTOKEN tkBuff[MAXLEN_TBUFFER];
+	static uint8_t first[CHECK_ARENA_BUFF];
+	CHECK_STR s = { .seed = 0xA4E7u };
+	CHECK_STR* exprs = malloc(CHECK_ARENA_EXPRS * sizeof(CHECK_STR));
+	MEVE_CONTEXT fixed, ctx;
+	MEVE_ARENA arena;
+	size_t blocks = 0;
+	size_t grown = 0;
+	size_t longer = 0;
+	size_t fails = 0;
+
+	if (!exprs)
+	{
+		printf("arena: out of memory\n");
+		return 1;
+	}
+
+	/* Long sums, deep nestings, and sums of generated expressions. */
+	for (size_t i = 0; i < CHECK_ARENA_EXPRS; i++)
+	{
+		const size_t count = 1 + CheckRand(&s, CHECK_ARENA_TERMS);
+
+		exprs[i].len = 0;
+		exprs[i].buff[0] = '\0';
+
+		switch (i % 4)
+		{
+			case 0:
+			{
+				CheckPut(&exprs[i], "x");
+				CheckPutRepeat(&exprs[i], "+(x*y-1)", count);
+				break;
+			}
+			case 1:
+			{
+				CheckPutRepeat(&exprs[i], "sin(", count % CHECK_ARENA_DEPTH);
+				CheckPut(&exprs[i], "x*y");
+				CheckPutRepeat(&exprs[i], ")", count % CHECK_ARENA_DEPTH);
+				break;
+			}
+			case 2:
+			{
+				CheckPutRepeat(&exprs[i], "(y-", count % CHECK_ARENA_DEPTH);
+				CheckPut(&exprs[i], "x");
+				CheckPutRepeat(&exprs[i], ")", count % CHECK_ARENA_DEPTH);
+				break;
+			}
+			default:
+			{
+				CHECK_STR sub = { .seed = s.seed };
+
+				CheckPut(&exprs[i], "0");
+
+				for (size_t j = 0; j < count % 8 + 1; j++)
+				{
+					CheckGen(&sub);
+					CheckPut(&exprs[i], "+");
+					CheckPut(&exprs[i], sub.buff);
+				}
+				s.seed = sub.seed;
+				break;
+			}
+		}
+	}
+
+	MeveInit(&fixed, tkBuff, sizeof(tkBuff), "");
+	MeveSetVars(&fixed, gVars, sizeof(gVars) / sizeof(gVars[0]));
+	MeveInit(&ctx, tkBuff, sizeof(tkBuff), "");
+	MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+	MeveArenaInit(&arena, first, sizeof(first));
+	arena.alloc = &CheckArenaAlloc;
+	arena.free = &CheckArenaFree;
+	arena.user = &blocks;
+	MeveSetArena(&ctx, &arena);
+
+	for (size_t round = 0; round < 3; round++)
+	{
+		for (size_t i = 0; i < CHECK_ARENA_EXPRS; i++)
+		{
+			num_t want;
+			MeveCode code, got;
+
+			CheckPoint(&s);
+			code = CheckEval(exprs[i].buff, &want);
+
+			if (code != MEVE_ERR_OK)
+			{
+				CheckReport(&fails, "arena", exprs[i].buff, "rejected by the large buffer", 0, (num_t)code);
+			}
+
+			/* The expressions the fixed buffers reject are the ones the
+			 * arena has to hold. */
+			if (!round)
+			{
+				fixed.iStr = exprs[i].buff;
+				MeveUpdate(&fixed);
+				longer += code == MEVE_ERR_OK && EvalString(&fixed) != MEVE_ERR_OK;
+			}
+
+			ctx.iStr = exprs[i].buff;
+			MeveUpdate(&ctx);
+			got = EvalString(&ctx);
+
+			if (got != code || (code == MEVE_ERR_OK && !CheckSame(want, ctx.ans)))
+			{
+				CheckReport(&fails, "arena", exprs[i].buff, "arena context against a large buffer", want, ctx.ans);
+			}
+
+			/* Evaluating again without changing the string gives the
+			 * same result. */
+			MeveUpdate(&ctx);
+
+			if (EvalString(&ctx) != code || (code == MEVE_ERR_OK && !CheckSame(want, ctx.ans)))
+			{
+				CheckReport(&fails, "arena", exprs[i].buff, "again after MeveUpdate()", want, ctx.ans);
+			}
+		}
+
+		/* The later rounds reuse the blocks of the first. */
+		if (!round)
+		{
+			grown = blocks;
+		}
+		else if (blocks != grown)
+		{
+			CheckReport(&fails, "arena", "", "blocks not reused", (num_t)grown, (num_t)blocks);
+		}
+		MeveArenaReset(&arena);
+	}
+
+	MeveArenaFree(&arena);
+
+	if (blocks)
+	{
+		CheckReport(&fails, "arena", "", "blocks left after MeveArenaFree()", 0, (num_t)blocks);
+	}
+
+	if (!longer)
+	{
+		printf("arena: no expression was longer than the fixed buffers\n");
+		fails++;
+	}
+
+	free(exprs);
+	printf("arena: %zu expressions, %zu longer than the fixed buffers, %zu blocks, %zu failures\n",
+		(size_t)CHECK_ARENA_EXPRS, longer, grown, fails);
+	return fails;
+}
+
+/* The instrumentation counters after EvalString(), and after the stages
+ * run one at a time following MeveStatsReset(). Without MEVE_USE_STATS,
+ * MeveStatsSnapshot() fails with zeroed counters. */
+static size_t CheckStats(void)
+{
+	static const char str[] = "2*x + sin(y) + 5 choose 2";
+	static const MEVE_STATS zero;
+	MEVE_CONTEXT ctx;
+	MEVE_STATS first;
+	MeveCode code, snap;
+	size_t fails = 0;
+
+	gX = 1;
+	gY = 2;
+	MeveInit(&ctx, gTkBuff, sizeof(gTkBuff), str);
+	MeveSetVars(&ctx, gVars, sizeof(gVars) / sizeof(gVars[0]));
+	code = EvalString(&ctx);
+	snap = MeveStatsSnapshot(&ctx, &first);
+
+#ifdef MEVE_USE_STATS
+	MEVE_STATS stats;
+	const num_t ans = ctx.ans;
+
+	if (code != MEVE_ERR_OK || snap != MEVE_ERR_OK)
+	{
+		CheckReport(&fails, "stats", str, "not evaluated or not counted", (num_t)code, (num_t)snap);
+	}
+
+	/* EvalString() reads the tokens and converts them in one stage. */
+	if (!first.runs[MEVE_STAGE_PARSE] || !first.runs[MEVE_STAGE_OPTIMIZE] || !first.runs[MEVE_STAGE_EVAL])
+	{
+		CheckReport(&fails, "stats", str, "stages of EvalString() not counted",
+			(num_t)first.runs[MEVE_STAGE_PARSE], (num_t)first.runs[MEVE_STAGE_EVAL]);
+	}
+
+	if (!first.tokens || !first.evalTokens || !first.maxDepth)
+	{
+		CheckReport(&fails, "stats", str, "tokens not counted", (num_t)first.tokens, (num_t)first.evalTokens);
+	}
+
+	/* The multiplication and sine are evaluated, the combination folded. */
+	if (!first.calls[MEVE_OP_MUL] || !first.calls[MEVE_OP_SIN] || !first.calls[MEVE_OP_CHOOSE])
+	{
+		CheckReport(&fails, "stats", str, "calls not counted", (num_t)first.calls[MEVE_OP_MUL], (num_t)first.calls[MEVE_OP_SIN]);
+	}
+
+	MeveStatsReset(&ctx);
+
+	if (MeveStatsSnapshot(&ctx, &stats) != MEVE_ERR_OK || memcmp(&stats, &zero, sizeof(stats)))
+	{
+		CheckReport(&fails, "stats", str, "not cleared by MeveStatsReset()", 0, (num_t)stats.runs[MEVE_STAGE_EVAL]);
+	}
+
+	/* The same string through the separate stages counts the same calls. */
+	MeveUpdate(&ctx);
+
+	if (CreateTokens(&ctx) != MEVE_ERR_OK || InfixToPostfix(&ctx) != MEVE_ERR_OK ||
+		PostfixOptimize(&ctx) != MEVE_ERR_OK || PostfixEval(&ctx) != MEVE_ERR_OK || !CheckSame(ans, ctx.ans))
+	{
+		CheckReport(&fails, "stats", str, "stages against EvalString()", ans, ctx.ans);
+	}
+
+	MeveStatsSnapshot(&ctx, &stats);
+
+	if (!stats.runs[MEVE_STAGE_TOKENS] || !stats.runs[MEVE_STAGE_POSTFIX] || stats.runs[MEVE_STAGE_PARSE])
+	{
+		CheckReport(&fails, "stats", str, "separate stages not counted",
+			(num_t)stats.runs[MEVE_STAGE_TOKENS], (num_t)stats.runs[MEVE_STAGE_POSTFIX]);
+	}
+
+	if (stats.runs[MEVE_STAGE_OPTIMIZE] != first.runs[MEVE_STAGE_OPTIMIZE] ||
+		stats.runs[MEVE_STAGE_EVAL] != first.runs[MEVE_STAGE_EVAL] ||
+		memcmp(stats.calls, first.calls, sizeof(stats.calls)) ||
+		stats.tokens != first.tokens || stats.evalTokens != first.evalTokens)
+	{
+		CheckReport(&fails, "stats", str, "counted differently after MeveStatsReset()",
+			(num_t)first.evalTokens, (num_t)stats.evalTokens);
+	}
+
+	printf("stats: %llu eval ticks, %llu tokens, %zu failures\n",
+		(unsigned long long)first.ticks[MEVE_STAGE_EVAL], (unsigned long long)first.tokens, fails);
+#else
+	if (code != MEVE_ERR_OK || snap != MEVE_ERR_INVALIDPARAM || memcmp(&first, &zero, sizeof(first)))
+	{
+		CheckReport(&fails, "stats", str, "counted without MEVE_USE_STATS", (num_t)code, (num_t)snap);
+	}
+
+	printf("stats: not built, %zu failures\n", fails);
+#endif
+	return fails;
+}
+
+int main(void)
+{
+	size_t fails = 0;
+
+	fails += CheckJit();
+	fails += CheckShare();
+	fails += CheckShareParams();
+	fails += CheckShapeRebind();
+	fails += CheckCacheFail();
+	fails += CheckInterval();
+	fails += CheckGrad();
+	fails += CheckIncr();
+	fails += CheckImage();
+	fails += CheckFastMath();
+	fails += CheckChoose();
+	fails += CheckPool();
+	fails += CheckArena();
+	fails += CheckStats();
+	return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
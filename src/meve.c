@@ -2,7 +2,17 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <math.h>
+#include <locale.h>
 #include "mevemath.h"
+#include <pthread.h>
+#ifdef MEVE_USE_STATS
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
 
 #define SPS_DECIMAL				'.'	/* Decimal symbol.					*/
 #define SPS_COMMA				','	/* Parameter delimiter symbol.		*/
@@ -14,25 +24,75 @@
 
 #define MEVE_MAX_FUN_ARITY		2	/* Maximum function arity.			*/
 
+#define KEYWORD_MAXLEN			16	/* Maximum keyword length.			*/
+
+#define ARENA_ALIGN				16	/* Alignment of the allocations.	*/
+#define ARENA_MINSIZE			4096	/* Smallest allocated block.	*/
+
+#define NUMSTR_MAXLEN			64	/* Maximum literal copied on stack.	*/
+#define NUMSTR_MAXEXP			100000	/* Exponent saturation limit.	*/
+
+#define SHARE_NONE				UINT32_MAX	/* Missing operand of a node.	*/
+#define SHARE_EXPANDED			UINT32_C(0x80000000)	/* Operands emitted.	*/
+
+/* Operands of a DAG node in the order they are hashed. The sum and the
+ * product are exactly commutative, so both orders share a node. */
+#define SHARE_COMMUTES(op)		((op) == MEVE_OP_ADD || (op) == MEVE_OP_MUL)
+#define SHARE_FIRST(op, a, b)	(SHARE_COMMUTES(op) && (b) < (a) ? (b) : (a))
+#define SHARE_SECOND(op, a, b)	(SHARE_COMMUTES(op) && (b) < (a) ? (a) : (b))
+
+#define SHARE_MAXPOW			16	/* Largest power made of products.	*/
+#define SHARE_GROWTH			8	/* Most nodes of a rewritten node.	*/
+
+/* Operation codes emitted from a DAG of n nodes: every node, a store of
+ * each node and a load of each operand at most. */
+#define SHARE_MAXLEN(n)			(4 * (n))
+
+/* Instrumentation of the context, compiled out unless MEVE_USE_STATS
+ * is defined. STATS_BEGIN declares the start tick of a stage. */
+#ifdef MEVE_USE_STATS
+#define STATS_BEGIN(t)			const uint64_t t = StatsTick()
+#define STATS_END(ctx, stage, t)	((ctx)->stats.ticks[stage] += StatsTick() - (t),\
+									(ctx)->stats.runs[stage]++)
+#define STATS_ADD(ctx, field, n)	((ctx)->stats.field += (n))
+#define STATS_MAX(ctx, field, n)	((ctx)->stats.field = (ctx)->stats.field < (n) ?\
+									(n) : (ctx)->stats.field)
+#else
+#define STATS_BEGIN(t)			((void)0)
+#define STATS_END(ctx, stage, t)	((void)0)
+#define STATS_ADD(ctx, field, n)	((void)0)
+#define STATS_MAX(ctx, field, n)	((void)0)
+#endif
+
+/* Largest power of ten that is exactly representable by num_t.		*/
+#define NUM_MAXPOW10			(MEVE_NUM_MANT_DIG * 100 / 233)
+
+/* Largest integer mantissa that is exactly representable by num_t.	*/
+#if MEVE_NUM_MANT_DIG >= 64
+#define NUM_MAXEXACT			UINT64_MAX
+#else
+#define NUM_MAXEXACT			(UINT64_C(1) << MEVE_NUM_MANT_DIG)
+#endif
+
 static const MEVE_FUN gFunList[] =
 {
 	/*
-	 *	name		function ptr	arity	associavity
+	 *	name		function ptr	arity	associavity	operation code
 	*/
-	{	"exp",		&Exp,			1,		AS_RTL	},
-	{	"sqrt",		&Sqrt,			1,		AS_RTL	},
-	{	"abs",		&Abs,			1,		AS_RTL	},
-	{	"sin",		&Sin,			1,		AS_RTL	},
-	{	"cos",		&Cos,			1,		AS_RTL	},
-	{	"tan",		&Tan,			1,		AS_RTL	},
-	{	"arcsin",	&ArcSin,		1,		AS_RTL	},
-	{	"arccos",	&ArcCos,		1,		AS_RTL	},
-	{	"arctan",	&ArcTan,		1,		AS_RTL	},
-	{	"log10",	&Log10,			1,		AS_RTL	},
-	{	"log",		&Log,			1,		AS_RTL	},
-	{	"min",		&Min,			2,		AS_RTL	},
-	{	"max",		&Max,			2,		AS_RTL	},
-	{	"!",		&Factorial,		1,		AS_LTR	},
+	{	"exp",		&Exp,			1,		AS_RTL,		MEVE_OP_EXP		},
+	{	"sqrt",		&Sqrt,			1,		AS_RTL,		MEVE_OP_SQRT	},
+	{	"abs",		&Abs,			1,		AS_RTL,		MEVE_OP_ABS		},
+	{	"sin",		&Sin,			1,		AS_RTL,		MEVE_OP_SIN		},
+	{	"cos",		&Cos,			1,		AS_RTL,		MEVE_OP_COS		},
+	{	"tan",		&Tan,			1,		AS_RTL,		MEVE_OP_TAN		},
+	{	"arcsin",	&ArcSin,		1,		AS_RTL,		MEVE_OP_ASIN	},
+	{	"arccos",	&ArcCos,		1,		AS_RTL,		MEVE_OP_ACOS	},
+	{	"arctan",	&ArcTan,		1,		AS_RTL,		MEVE_OP_ATAN	},
+	{	"log10",	&Log10,			1,		AS_RTL,		MEVE_OP_LOG10	},
+	{	"log",		&Log,			1,		AS_RTL,		MEVE_OP_LOG		},
+	{	"min",		&Min,			2,		AS_RTL,		MEVE_OP_MIN		},
+	{	"max",		&Max,			2,		AS_RTL,		MEVE_OP_MAX		},
+	{	"!",		&Factorial,		1,		AS_LTR,		MEVE_OP_FACT	},
 };
 
 enum OperatorPrecedence
@@ -47,17 +107,45 @@ enum OperatorPrecedence
 static const MEVE_OPR gOprList[] =
 {
 	/*
-	 *	symbol		function ptr	precedence		associativity
+	 *	symbol		function ptr	precedence		associativity	operation code
 	*/
-	{	"+",		&Add,			OPR_P_ADD,		AS_LTR	},
-	{	"-",		&Sub,			OPR_P_ADD,		AS_LTR	},
-	{	"*",		&Mult,			OPR_P_MULT,		AS_LTR	},
-	{	"/",		&Div,			OPR_P_MULT,		AS_LTR	},
-	{	"mod",		&Mod,			OPR_P_MULT,		AS_LTR	},
-	{	"choose",	&Choose,		OPR_P_STA,		AS_LTR	},
-	{	"+",		&UnAdd,			OPR_P_UNARY,	AS_RTL	},
-	{	"-",		&UnSub,			OPR_P_UNARY,	AS_RTL	},
-	{	"^",		&Pow,			OPR_P_POW,		AS_RTL	},
+	{	"+",		&Add,			OPR_P_ADD,		AS_LTR,			MEVE_OP_ADD		},
+	{	"-",		&Sub,			OPR_P_ADD,		AS_LTR,			MEVE_OP_SUB		},
+	{	"*",		&Mult,			OPR_P_MULT,		AS_LTR,			MEVE_OP_MUL		},
+	{	"/",		&Div,			OPR_P_MULT,		AS_LTR,			MEVE_OP_DIV		},
+	{	"mod",		&Mod,			OPR_P_MULT,		AS_LTR,			MEVE_OP_MOD		},
+	{	"choose",	&Choose,		OPR_P_STA,		AS_LTR,			MEVE_OP_CHOOSE	},
+	{	"+",		&UnAdd,			OPR_P_UNARY,	AS_RTL,			MEVE_OP_POS		},
+	{	"-",		&UnSub,			OPR_P_UNARY,	AS_RTL,			MEVE_OP_NEG		},
+	{	"^",		&Pow,			OPR_P_POW,		AS_RTL,			MEVE_OP_POW		},
+};
+
+/* Callbacks of the built-in operation codes.	*/
+static num_t(* const gOpFun[MEVE_OP_COUNT])(const num_t*) =
+{
+	[MEVE_OP_POS] = &UnAdd,
+	[MEVE_OP_NEG] = &UnSub,
+	[MEVE_OP_EXP] = &Exp,
+	[MEVE_OP_SQRT] = &Sqrt,
+	[MEVE_OP_ABS] = &Abs,
+	[MEVE_OP_SIN] = &Sin,
+	[MEVE_OP_COS] = &Cos,
+	[MEVE_OP_TAN] = &Tan,
+	[MEVE_OP_ASIN] = &ArcSin,
+	[MEVE_OP_ACOS] = &ArcCos,
+	[MEVE_OP_ATAN] = &ArcTan,
+	[MEVE_OP_LOG10] = &Log10,
+	[MEVE_OP_LOG] = &Log,
+	[MEVE_OP_FACT] = &Factorial,
+	[MEVE_OP_ADD] = &Add,
+	[MEVE_OP_SUB] = &Sub,
+	[MEVE_OP_MUL] = &Mult,
+	[MEVE_OP_DIV] = &Div,
+	[MEVE_OP_MOD] = &Mod,
+	[MEVE_OP_CHOOSE] = &Choose,
+	[MEVE_OP_POW] = &Pow,
+	[MEVE_OP_MIN] = &Min,
+	[MEVE_OP_MAX] = &Max,
 };
 
 static const MEVE_CONST gConstList[] =
@@ -79,47 +167,203 @@ static const MEVE_CONST gConstList[] =
 								(GetPrec(sTop) == GetPrec(&tk)		&&\
 								sTop->data.opr->as == AS_LTR)))))
 
-#define UNARYCHECK(out, index)	(!index										||\
-								(index										&&\
-								(out->tk[index - 1].type == MEVE_TT_OBRKT	||\
-								out->tk[index - 1].type == MEVE_TT_OPR		||\
-								out->tk[index - 1].type == MEVE_TT_PARAMDELIM)))
+#define UNARYCHECK(prev)		(!prev								||\
+								prev->type == MEVE_TT_OBRKT			||\
+								prev->type == MEVE_TT_OPR			||\
+								prev->type == MEVE_TT_PARAMDELIM)
 
 #define GETSTACK_MAXLEN(s)		(s.sz / sizeof(MTOKEN))
 
-int32_t GetPrec(
+#define ARENA_ALIGNUP(n)		(((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+#define ARENA_BLOCKDATA(b)		((uint8_t*)(b) + ARENA_ALIGNUP(sizeof(MEVE_ARENA_BLOCK)))
+
+#define COUNTOF(a)				(sizeof(a) / sizeof(a[0]))
+
+#define KEYWORD_MAXNODES		((COUNTOF(gFunList) + COUNTOF(gOprList) +\
+								COUNTOF(gConstList)) * KEYWORD_MAXLEN + 1)
+
+/* Keyword trie node.					*/
+typedef struct KEYWORD_NODE
+{
+	const MEVE_OPR* opr[2];		/* Binary and unary operators.			*/
+	const MEVE_FUN* fun;		/* Function ending at this node.		*/
+	const MEVE_CONST* cst;		/* Constant ending at this node.		*/
+	uint16_t child;				/* Index of the first child node.		*/
+	uint16_t next;				/* Index of the next sibling node.		*/
+	char symb;					/* Lowercase symbol of the node.		*/
+}KEYWORD_NODE;
+
+/* Longest keywords matching an input position.	*/
+typedef struct KEYWORD_MATCH
+{
+	const MEVE_OPR* opr[2];		/* Binary and unary operators.			*/
+	const MEVE_FUN* fun;		/* Function.							*/
+	const MEVE_CONST* cst;		/* Constant.							*/
+}KEYWORD_MATCH;
+
+/* Node of the expression DAG built by ProgramShare().	*/
+typedef struct SHARE_NODE
+{
+	uint32_t a;					/* First operand, or SHARE_NONE.		*/
+	uint32_t b;					/* Second operand, or SHARE_NONE.		*/
+	uint32_t uses;				/* Operators still reading the node.	*/
+	uint16_t arg;				/* Operand stream index.				*/
+	uint16_t slot;				/* Temporary slot, or UINT16_MAX.		*/
+	uint8_t op;					/* Operation code.						*/
+}SHARE_NODE;
+
+/* Expression DAG built by ProgramShare().	*/
+typedef struct SHARE_DAG
+{
+	SHARE_NODE* node;			/* Nodes in creation order.				*/
+	size_t nLen;				/* Number of nodes.						*/
+	uint32_t* table;			/* Hash table of the nodes, plus one.	*/
+	size_t hLen;				/* Size of the table, a power of two.	*/
+	bool rewrite;				/* Whether nodes may be rewritten.		*/
+	bool shared;				/* Whether an operator is read twice.	*/
+}SHARE_DAG;
+
+/* Case-folded trie of the operators, functions and constants, built once
+ * by MeveInit(). The root is the node 0. */
+static KEYWORD_NODE gKeyTrie[KEYWORD_MAXNODES];
+static size_t gKeyTrieLen;
+static const MEVE_OPR* gOprMult;
+
+/* Builds the trie in the first MeveInit() of any thread. */
+static pthread_once_t gKeyTrieOnce = PTHREAD_ONCE_INIT;
+
+static int32_t GetPrec(
 	const MTOKEN* tk)
 {
 	return tk->data.opr->prec;
 }
 
-bool IsDigit(
+static bool IsDigit(
 	const char symb)
 {
 	return (((uint32_t)symb - '0') < 10u) || (symb == SPS_DECIMAL);
 }
 
-const MEVE_OPR* GetOperatorPtr(
+static uint16_t KeywordChild(
+	const uint16_t node,
+	const char symb)
+{
+	uint16_t child = gKeyTrie[node].child;
+
+	while (child && gKeyTrie[child].symb != symb)
+	{
+		child = gKeyTrie[child].next;
+	}
+	return child;
+}
+
+static KEYWORD_NODE* KeywordInsert(
+	const char* str)
+{
+	uint16_t node = 0;
+
+	for (size_t i = 0; str[i]; i++)
+	{
+		const char symb = (char)tolower((unsigned char)str[i]);
+		uint16_t child = KeywordChild(node, symb);
+
+		if (!child)
+		{
+			if (gKeyTrieLen == KEYWORD_MAXNODES)
+			{
+				return NULL;
+			}
+
+			child = (uint16_t)gKeyTrieLen++;
+			gKeyTrie[child].symb = symb;
+			gKeyTrie[child].next = gKeyTrie[node].child;
+			gKeyTrie[node].child = child;
+		}
+		node = child;
+	}
+	return &gKeyTrie[node];
+}
+
+static void KeywordMatch(
+	KEYWORD_MATCH* kw,
+	const char* str)
+{
+	uint16_t node = 0;
+
+	kw->opr[0] = kw->opr[1] = NULL;
+	kw->fun = NULL;
+	kw->cst = NULL;
+
+	/* Walks the trie once, keeping the longest match of each kind. */
+	for (size_t i = 0; str[i]; i++)
+	{
+		if (!(node = KeywordChild(node, (char)tolower((unsigned char)str[i]))))
+		{
+			break;
+		}
+
+		kw->opr[0] = gKeyTrie[node].opr[0] ? gKeyTrie[node].opr[0] : kw->opr[0];
+		kw->opr[1] = gKeyTrie[node].opr[1] ? gKeyTrie[node].opr[1] : kw->opr[1];
+		kw->fun = gKeyTrie[node].fun ? gKeyTrie[node].fun : kw->fun;
+		kw->cst = gKeyTrie[node].cst ? gKeyTrie[node].cst : kw->cst;
+	}
+}
+
+static const MEVE_OPR* GetOperatorPtr(
 	const char* str,
 	const bool unary)
 {
-	for (size_t i = 0; i < sizeof(gOprList) / sizeof(MEVE_OPR); i++)
+	KEYWORD_MATCH kw;
+
+	KeywordMatch(&kw, str);
+	return kw.opr[unary];
+}
+
+static void KeywordsInit(void)
+{
+	KEYWORD_NODE* node;
+
+	gKeyTrieLen = 1;
+
+	/* The first entry of a table wins when two entries share a name. */
+	for (size_t i = 0; i < COUNTOF(gOprList); i++)
+	{
+		const bool unary = gOprList[i].prec == OPR_P_UNARY;
+
+		if ((node = KeywordInsert(gOprList[i].str)) && !node->opr[unary])
+		{
+			node->opr[unary] = &gOprList[i];
+		}
+	}
+
+	for (size_t i = 0; i < COUNTOF(gFunList); i++)
 	{
-		if (!STRNICMP(str, gOprList[i].str, strlen(gOprList[i].str)) &&
-			unary == (gOprList[i].prec == OPR_P_UNARY))
+		if ((node = KeywordInsert(gFunList[i].str)) && !node->fun)
 		{
-			return &gOprList[i];
+			node->fun = &gFunList[i];
 		}
 	}
-	return NULL;
+
+	for (size_t i = 0; i < COUNTOF(gConstList); i++)
+	{
+		if ((node = KeywordInsert(gConstList[i].str)) && !node->cst)
+		{
+			node->cst = &gConstList[i];
+		}
+	}
+
+	gOprMult = GetOperatorPtr("*", false);
 }
 
-bool IsOperator(
+static bool IsOperator(
 	const MEVE_OPR** const opr,
+	KEYWORD_MATCH* kw,
 	const char* str,
 	const bool isUnary)
 {
-	*opr = GetOperatorPtr(str, isUnary);
+	KeywordMatch(kw, str);
+	*opr = kw->opr[isUnary];
 	if (*opr)
 	{
 		return true;
@@ -127,187 +371,455 @@ bool IsOperator(
 	return false;
 }
 
-bool IsOpenBrackets(
+static bool IsOpenBrackets(
 	const char symb)
 {
 	return symb == SPS_OBRKT;
 }
 
-bool IsDelimiter(
+static bool IsDelimiter(
 	const char symb)
 {
 	return symb == SPS_COMMA;
 }
 
-bool IsCloseBrackets(
+static bool IsCloseBrackets(
 	const char symb)
 {
 	return symb == SPS_CBRKT;
 }
 
-bool IsConstant(
+static bool IsConstant(
 	const MEVE_CONST** c,
-	const char* str)
+	const KEYWORD_MATCH* kw)
+{
+	*c = kw->cst;
+	return *c != NULL;
+}
+
+static bool IsIdentifierChar(
+	const char symb,
+	const bool first)
+{
+	return isalpha((unsigned char)symb) || symb == '_' ||
+		(!first && isdigit((unsigned char)symb));
+}
+
+static bool IsVariable(
+	const MEVE_VAR** var,
+	const MEVE_CONTEXT* ctx,
+	const char* str,
+	size_t* len)
 {
-	for (int i = 0; i < (sizeof(gConstList) / sizeof(MEVE_CONST)); i++)
+	size_t idLen = 0;
+
+	if (!ctx->varCount || !IsIdentifierChar(str[0], true))
+	{
+		return false;
+	}
+
+	while (IsIdentifierChar(str[idLen], !idLen))
+	{
+		idLen++;
+	}
+
+	for (size_t i = 0; i < ctx->varCount; i++)
 	{
-		if (!STRNICMP(str, gConstList[i].str, strlen(gConstList[i].str)))
+		if (!STRNICMP(str, ctx->vars[i].str, idLen) &&
+			ctx->vars[i].str[idLen] == '\0')
 		{
-			*c = &gConstList[i];
+			*var = &ctx->vars[i];
+			*len = idLen;
 			return true;
 		}
 	}
 	return false;
 }
 
-bool IsWhitespace(
+static bool IsWhitespace(
 	const char smb)
 {
 	return isspace(smb);
 }
 
-bool IsFunction(
+static bool IsFunction(
 	const MEVE_FUN** fun,
-	const char* str)
+	const KEYWORD_MATCH* kw)
+{
+	*fun = kw->fun;
+	return *fun != NULL;
+}
+
+static void* ArenaAlloc(
+	MEVE_ARENA* arena,
+	size_t sz)
 {
-	for (int i = 0; i < (sizeof(gFunList) / sizeof(MEVE_FUN)); i++)
+	MEVE_ARENA_BLOCK* block = arena->cur ? arena->cur->next : arena->head;
+	MEVE_ARENA_BLOCK* last = arena->cur;
+	void* ptr;
+
+	sz = ARENA_ALIGNUP(sz);
+
+	if (sz > arena->left)
 	{
-		if (!STRNICMP(str, gFunList[i].str, strlen(gFunList[i].str)))
+		/* Blocks kept from before the last reset are reused in order.
+		 * Those too small stay unused until the next reset. */
+		for (; block && block->sz < sz; block = block->next)
 		{
-			*fun = &gFunList[i];
-			return true;
+			last = block;
+		}
+
+		if (!block)
+		{
+			size_t blockSz = last ? last->sz * 2 : arena->buffSz * 2;
+
+			blockSz = blockSz < ARENA_MINSIZE ? ARENA_MINSIZE : blockSz;
+			blockSz = blockSz < sz ? sz : blockSz;
+
+			block = arena->alloc ?
+				arena->alloc(arena->user, ARENA_ALIGNUP(sizeof(MEVE_ARENA_BLOCK)) + blockSz) :
+				malloc(ARENA_ALIGNUP(sizeof(MEVE_ARENA_BLOCK)) + blockSz);
+
+			if (!block)
+			{
+				return NULL;
+			}
+
+			block->sz = blockSz;
+
+			while (last && last->next)
+			{
+				last = last->next;
+			}
+
+			if (last)
+			{
+				block->next = last->next;
+				last->next = block;
+			}
+			else
+			{
+				block->next = arena->head;
+				arena->head = block;
+			}
 		}
+
+		arena->cur = block;
+		arena->ptr = ARENA_BLOCKDATA(block);
+		arena->left = block->sz;
 	}
-	return false;
+
+	ptr = arena->ptr;
+	arena->ptr += sz;
+	arena->left -= sz;
+	return ptr;
 }
 
-bool ImplicitMulNum(
-	MEVE_CONTEXT* ctx)
+/* Makes room for n more tokens, moving the stack to a larger buffer from
+ * the arena when there is one. */
+static bool StackReserve(
+	MEVE_ARENA* arena,
+	TSTACK* stack,
+	const size_t n)
 {
-	const size_t len = ctx->expr.len;
+	const size_t maxLen = GETSTACK_MAXLEN((*stack));
+	size_t len = maxLen * 2;
+	MTOKEN* tk;
 
-	if (!len)
+	if (stack->len + n <= maxLen)
 	{
 		return true;
 	}
 
-	if (ctx->expr.tk[len - 1].type == MEVE_TT_CBRKT ||
-		ctx->expr.tk[len - 1].type == MEVE_TT_CONST ||
-		(ctx->expr.tk[len - 1].type == MEVE_TT_FUN &&
-			ctx->expr.tk[len - 1].data.fun->as == AS_LTR))
+	if (!arena)
 	{
-		if (len + 2 > GETSTACK_MAXLEN(ctx->expr))
-		{
-			return false;
-		}
+		return false;
+	}
+
+	len = len < MAXLEN_TBUFFER ? MAXLEN_TBUFFER : len;
+	len = len < stack->len + n ? stack->len + n : len;
 
-		ctx->expr.tk[len].type = MEVE_TT_OPR;
-		ctx->expr.tk[len].data.opr = GetOperatorPtr("*", false);
-		ctx->expr.len++;
+	if (!(tk = ArenaAlloc(arena, len * sizeof(MTOKEN))))
+	{
+		return false;
 	}
+
+	/* The whole buffer is copied, since a token may have been written
+	 * past the end of the stack before it is pushed. */
+	memcpy(tk, stack->tk, maxLen * sizeof(MTOKEN));
+	stack->tk = tk;
+	stack->sz = len * sizeof(MTOKEN);
+	stack->top = stack->len ? &tk[stack->len - 1] : NULL;
 	return true;
 }
 
-bool ImplicitMulBrkt(
-	MEVE_CONTEXT* ctx)
+/* True when the previous token ends an operand, so an operand that
+ * follows it is multiplied by it. */
+static bool IsOperandEnd(
+	const MTOKEN* prev)
 {
-	const size_t len = ctx->expr.len;
+	return prev->type == MEVE_TT_CBRKT ||
+		prev->type == MEVE_TT_NUM ||
+		prev->type == MEVE_TT_CONST ||
+		prev->type == MEVE_TT_VAR ||
+		(prev->type == MEVE_TT_FUN && prev->data.fun->as == AS_LTR);
+}
+
+static bool ImplicitMulNum(
+	const MTOKEN* prev)
+{
+	/* Two numbers in a row are not multiplied. */
+	return prev && prev->type != MEVE_TT_NUM && IsOperandEnd(prev);
+}
+
+static bool ImplicitMulBrkt(
+	const MTOKEN* prev)
+{
+	return prev && IsOperandEnd(prev);
+}
+
+static bool ImplicitMulFun(
+	const MTOKEN* prev,
+	const MEVE_FUN* fun)
+{
+	/* Postfix functions apply to the previous operand, and a constant
+	 * is not multiplied by the function that follows it. */
+	return prev && fun->as != AS_LTR && prev->type != MEVE_TT_CONST && IsOperandEnd(prev);
+}
+
+static bool ImplicitMulConst(
+	const MTOKEN* prev)
+{
+	return prev && IsOperandEnd(prev);
+}
+
+static bool ImplicitMulVar(
+	const MTOKEN* prev)
+{
+	return prev && IsOperandEnd(prev);
+}
+
+#ifdef MEVE_USE_STRTOLD
+static size_t StrToNum(
+	num_t* res,
+	const char* strInput)
+{
+	char* endPtr = NULL;
+	*res = MEVE_STRTONUM(strInput, &endPtr);
+	return endPtr ? (size_t)(endPtr - strInput) : 0U;
+}
+#else
+static const num_t gPow10[] =
+{
+	1e0L,	1e1L,	1e2L,	1e3L,	1e4L,	1e5L,	1e6L,
+	1e7L,	1e8L,	1e9L,	1e10L,	1e11L,	1e12L,	1e13L,
+	1e14L,	1e15L,	1e16L,	1e17L,	1e18L,	1e19L,	1e20L,
+	1e21L,	1e22L,	1e23L,	1e24L,	1e25L,	1e26L,	1e27L,
+};
 
-	if (!len)
+static int HexDigit(
+	const char symb)
+{
+	if (isdigit((unsigned char)symb))
 	{
-		return true;
+		return symb - '0';
+	}
+	else if (isxdigit((unsigned char)symb))
+	{
+		return (tolower((unsigned char)symb) - 'a') + 10;
+	}
+	return -1;
+}
+
+static size_t StrToNumSlow(
+	num_t* res,
+	const char* strInput,
+	const size_t len)
+{
+	const char* dp = localeconv()->decimal_point;
+	const size_t dpLen = strlen(dp);
+	char buff[NUMSTR_MAXLEN];
+	char* str = buff;
+	size_t j = 0;
+
+	/* The literal is copied so that strtold() neither depends on the decimal
+	 * point of the current locale nor reads past the scanned literal. */
+	if (len * dpLen + 1 > sizeof(buff) && !(str = malloc(len * dpLen + 1)))
+	{
+		return 0;
 	}
 
-	if (ctx->expr.tk[len - 1].type == MEVE_TT_CBRKT ||
-		ctx->expr.tk[len - 1].type == MEVE_TT_NUM ||
-		ctx->expr.tk[len - 1].type == MEVE_TT_CONST ||
-		(ctx->expr.tk[len - 1].type == MEVE_TT_FUN &&
-			ctx->expr.tk[len - 1].data.fun->as == AS_LTR))
+	for (size_t i = 0; i < len; i++)
 	{
-		if (len + 2 > GETSTACK_MAXLEN(ctx->expr))
+		if (strInput[i] == SPS_DECIMAL)
 		{
-			return false;
+			memcpy(&str[j], dp, dpLen);
+			j += dpLen;
+		}
+		else
+		{
+			str[j++] = strInput[i];
 		}
-
-		ctx->expr.tk[len].type = MEVE_TT_OPR;
-		ctx->expr.tk[len].data.opr = GetOperatorPtr("*", false);
-		ctx->expr.len++;
 	}
+	str[j] = '\0';
 
-	return true;
+	*res = MEVE_STRTONUM(str, NULL);
+
+	if (str != buff)
+	{
+		free(str);
+	}
+	return len;
 }
 
-bool ImplicitMulFun(
-	MEVE_CONTEXT* ctx)
+static size_t StrToHex(
+	num_t* res,
+	const char* strInput)
 {
-	const size_t len = ctx->expr.len;
+	const char* str = strInput + 2;
+	uint64_t m = 0;
+	bool exact = true;
 
-	if (!len)
+	for (; HexDigit(*str) >= 0; str++)
 	{
-		return true;
+		exact = exact && m <= (NUM_MAXEXACT >> 4);
+		m = (m << 4) | (uint64_t)HexDigit(*str);
 	}
 
-	if (ctx->expr.tk[len].data.fun->as != AS_LTR)
+	if (*str == SPS_DECIMAL || tolower((unsigned char)*str) == 'p')
 	{
-		if (ctx->expr.tk[len - 1].type == MEVE_TT_NUM ||
-			ctx->expr.tk[len - 1].type == MEVE_TT_CBRKT ||
-			(ctx->expr.tk[len - 1].type == MEVE_TT_FUN &&
-				ctx->expr.tk[len - 1].data.fun->as == AS_LTR))
+		/* Hexadecimal floats take the general path. */
+		const char* end = str;
+
+		if (*end == SPS_DECIMAL)
+		{
+			for (end++; HexDigit(*end) >= 0; end++);
+		}
+
+		if (tolower((unsigned char)*end) == 'p')
 		{
-			if (len + 2 > GETSTACK_MAXLEN(ctx->expr))
+			const char* exp = end + 1 + (end[1] == '+' || end[1] == '-');
+
+			if (isdigit((unsigned char)*exp))
 			{
-				return false;
+				for (end = exp; isdigit((unsigned char)*end); end++);
 			}
-
-			ctx->expr.tk[len + 1].data.fun = ctx->expr.tk[len].data.fun;
-			ctx->expr.tk[len].data.opr = GetOperatorPtr("*", false);
-			ctx->expr.tk[len].type = MEVE_TT_OPR;
-			ctx->expr.len++;
 		}
+		return StrToNumSlow(res, strInput, (size_t)(end - strInput));
 	}
-	return true;
+
+	if (!exact)
+	{
+		return StrToNumSlow(res, strInput, (size_t)(str - strInput));
+	}
+
+	*res = (num_t)m;
+	return (size_t)(str - strInput);
 }
 
-bool ImplicitMulConst(
-	MEVE_CONTEXT* ctx)
+static size_t StrToNum(
+	num_t* res,
+	const char* strInput)
 {
-	const size_t len = ctx->expr.len;
+	const char* str = strInput;
+	uint64_t m = 0;
+	int32_t e10 = 0;
+	bool exact = true;
+	bool digits = false;
+
+#ifndef MEVE_NO_HEXLITERALS
+	if (str[0] == '0' && tolower((unsigned char)str[1]) == 'x' &&
+		(HexDigit(str[2]) >= 0 || (str[2] == SPS_DECIMAL && HexDigit(str[3]) >= 0)))
+	{
+		return StrToHex(res, strInput);
+	}
+#endif
 
-	if (!len)
+	/* Digits that do not fit the mantissa only scale the exponent, and
+	 * the literal is then exact only if all of them are zero. */
+	for (; isdigit((unsigned char)*str); str++, digits = true)
 	{
-		return true;
+		if (m <= (UINT64_MAX - 9) / 10)
+		{
+			m = m * 10 + (uint64_t)(*str - '0');
+		}
+		else
+		{
+			exact = exact && *str == '0';
+			e10++;
+		}
+	}
+
+	if (*str == SPS_DECIMAL)
+	{
+		for (str++; isdigit((unsigned char)*str); str++, digits = true)
+		{
+			if (m <= (UINT64_MAX - 9) / 10)
+			{
+				m = m * 10 + (uint64_t)(*str - '0');
+				e10--;
+			}
+			else
+			{
+				exact = exact && *str == '0';
+			}
+		}
+	}
+
+	if (!digits)
+	{
+		return 0;
 	}
 
-	if (ctx->expr.tk[len - 1].type == MEVE_TT_CBRKT ||
-		ctx->expr.tk[len - 1].type == MEVE_TT_NUM ||
-		ctx->expr.tk[len - 1].type == MEVE_TT_CONST ||
-		(ctx->expr.tk[len - 1].type == MEVE_TT_FUN &&
-			ctx->expr.tk[len - 1].data.fun->as == AS_LTR))
+	if (tolower((unsigned char)*str) == 'e')
 	{
-		if (len + 2 > GETSTACK_MAXLEN(ctx->expr))
+		const char* exp = str + 1 + (str[1] == '+' || str[1] == '-');
+		int32_t val = 0;
+
+		if (isdigit((unsigned char)*exp))
 		{
-			return false;
+			for (; isdigit((unsigned char)*exp); exp++)
+			{
+				val = val < NUMSTR_MAXEXP ? val * 10 + (*exp - '0') : val;
+			}
+
+			e10 += str[1] == '-' ? -val : val;
+			str = exp;
 		}
+	}
 
-		ctx->expr.tk[len + 1].data.cst = ctx->expr.tk[len].data.cst;
-		ctx->expr.tk[len].data.opr = GetOperatorPtr("*", false);
-		ctx->expr.tk[len].type = MEVE_TT_OPR;
-		ctx->expr.len++;
+	/* Both operands are exact, so the single rounding of the product or
+	 * the quotient gives the correctly rounded result. */
+	if (exact && m <= NUM_MAXEXACT && e10 >= -NUM_MAXPOW10 && e10 <= NUM_MAXPOW10)
+	{
+		*res = e10 < 0 ? (num_t)m / (num_t)gPow10[-e10] : (num_t)m * (num_t)gPow10[e10];
+		return (size_t)(str - strInput);
+	}
+	else if (!m && exact)
+	{
+		*res = 0;
+		return (size_t)(str - strInput);
 	}
 
-	return true;
+	return StrToNumSlow(res, strInput, (size_t)(str - strInput));
 }
+#endif
 
-size_t StrToNum(
-	num_t* res,
-	const char* strInput)
+#ifdef MEVE_USE_STATS
+static uint64_t StatsTick(void)
 {
-	char* endPtr = NULL;
-	*res = strtold(strInput, &endPtr);
-	return endPtr ? (size_t)(endPtr - strInput) : 0U;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
 }
+#endif
 
-void StackInit(
+static void StackInit(
 	TSTACK* stack,
 	MTOKEN* tkBuff,
 	size_t buffSz)
@@ -318,16 +830,16 @@ void StackInit(
 	stack->sz = buffSz;
 }
 
-void StackClear(
+static void StackClear(
 	TSTACK* stack)
 {
 	stack->len = 0;
 	stack->top = NULL;
 }
 
-void StackPush(
+static void StackPush(
 	TSTACK* stack,
-	MTOKEN* tk)
+	const MTOKEN* tk)
 {
 	if (tk)
 	{
@@ -338,7 +850,7 @@ void StackPush(
 	stack->top = &stack->tk[stack->len - 1];
 }
 
-void StackPushNum(
+static void StackPushNum(
 	TSTACK* stack,
 	const num_t val)
 {
@@ -348,7 +860,7 @@ void StackPushNum(
 	stack->top = &stack->tk[stack->len - 1];
 }
 
-void StackPop(
+static void StackPop(
 	TSTACK* const stack)
 {
 	if (stack->len > 0)
@@ -358,103 +870,262 @@ void StackPop(
 	}
 }
 
-MeveCode CreateTokens(
-	MEVE_CONTEXT* ctx)
+/* Appends a token to the output of a front end. */
+static MeveCode PostfixOut(
+	MEVE_CONTEXT* ctx,
+	const MTOKEN* tk)
 {
-	if (!ctx || !ctx->iStr)
+	if (!StackReserve(ctx->arena, &ctx->expr, 1))
 	{
-		return MEVE_ERR_INVALIDPARAM;
+		return MEVE_ERR_OUTOFSTACK;
 	}
 
-	if (!ctx->strLen)
+	ctx->expr.tk[ctx->expr.len++] = *tk;
+	return MEVE_ERR_OK;
+}
+
+/* Runs one step of the shunting yard, appending to ctx->expr. */
+static MeveCode ShuntToken(
+	MEVE_CONTEXT* ctx,
+	TSTACK* stack,
+	const MTOKEN* tk)
+{
+	MeveCode res;
+
+	/* Functions, operators and open brackets push one entry. */
+	if ((tk->type == MEVE_TT_FUN ||
+		tk->type == MEVE_TT_OPR ||
+		tk->type == MEVE_TT_OBRKT) &&
+		!StackReserve(ctx->arena, stack, 1))
 	{
-		return MEVE_ERR_INVALIDSIZE;
+		return MEVE_ERR_OUTOFSTACK;
 	}
 
-	for (size_t i = 0; i < ctx->strLen; i++)
+	switch (tk->type)
 	{
-		if (!IsWhitespace(ctx->iStr[i]))
+		case MEVE_TT_CONST:
+		case MEVE_TT_VAR:
+		case MEVE_TT_PARAM:
+		case MEVE_TT_NUM:
 		{
-			if (ctx->expr.len == GETSTACK_MAXLEN(ctx->expr))
-			{
-				return MEVE_ERR_OUTOFSTACK;
-			}
-			else if (IsDigit(ctx->iStr[i]))
+			return PostfixOut(ctx, tk);
+		}
+		case MEVE_TT_FUN:
+		case MEVE_TT_OBRKT:
+		{
+			StackPush(stack, tk);
+			break;
+		}
+		case MEVE_TT_OPR:
+		{
+			while (STACKISDONE(stack->top, (*tk)))
 			{
-				size_t strLen;
-
-				if (!ImplicitMulNum(ctx))
+				if ((res = PostfixOut(ctx, stack->top)) != MEVE_ERR_OK)
 				{
-					return MEVE_ERR_OUTOFSTACK;
+					return res;
 				}
-
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_NUM;
-				strLen = StrToNum(&ctx->expr.tk[ctx->expr.len].data.val, &ctx->iStr[i]);
-
-				i += strLen - 1;
-				ctx->expr.len++;
-			}
-			else if (IsOperator(
-				&ctx->expr.tk[ctx->expr.len].data.opr,
-				&ctx->iStr[i],
-				UNARYCHECK((&ctx->expr), ctx->expr.len)))
-			{
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_OPR;
-				i += strlen(ctx->expr.tk[ctx->expr.len].data.opr->str) - 1;
-				ctx->expr.len++;
+				StackPop(stack);
 			}
-			else if (IsOpenBrackets(ctx->iStr[i]))
+
+			StackPush(stack, tk);
+			break;
+		}
+		case MEVE_TT_CBRKT:
+		{
+			while (stack->top && stack->top->type != MEVE_TT_OBRKT)
 			{
-				if (!ImplicitMulBrkt(ctx))
+				/* Discard parameter delimiters */
+				if (stack->top->type != MEVE_TT_PARAMDELIM &&
+					(res = PostfixOut(ctx, stack->top)) != MEVE_ERR_OK)
 				{
-					return MEVE_ERR_OUTOFSTACK;
+					return res;
 				}
-
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_OBRKT;
-				ctx->expr.len++;
-			}
-			else if (IsCloseBrackets(ctx->iStr[i]))
-			{
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_CBRKT;
-				ctx->expr.len++;
+				StackPop(stack);
 			}
-			else if (IsDelimiter(ctx->iStr[i]))
+
+			/* The brackets are balanced when every close bracket finds
+			 * its open bracket on the stack. */
+			if (!stack->top)
 			{
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_PARAMDELIM;
-				ctx->expr.len++;
+				return MEVE_ERR_PARESNOTBALANCED;
 			}
-			else if (IsFunction(&ctx->expr.tk[ctx->expr.len].data.fun, &ctx->iStr[i]))
+			StackPop(stack);
+			break;
+		}
+		case MEVE_TT_PARAMDELIM:
+		{
+			while (stack->top &&
+				stack->top->type != MEVE_TT_OBRKT &&
+				stack->top->type != MEVE_TT_PARAMDELIM)
 			{
-				i += strlen(ctx->expr.tk[ctx->expr.len].data.fun->str) - 1;
-
-				if (!ImplicitMulFun(ctx))
+				if ((res = PostfixOut(ctx, stack->top)) != MEVE_ERR_OK)
 				{
-					return MEVE_ERR_OUTOFSTACK;
+					return res;
 				}
-
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_FUN;
-				ctx->expr.len++;
+				StackPop(stack);
 			}
-			else if (IsConstant(&ctx->expr.tk[ctx->expr.len].data.cst, &ctx->iStr[i]))
-			{
-				i += strlen(ctx->expr.tk[ctx->expr.len].data.cst->str) - 1;
+			break;
+		}
+		default:
+		{
+			/* Explicitly left empty */
+		}
+	}
+	return MEVE_ERR_OK;
+}
 
-				if (!ImplicitMulConst(ctx))
-				{
-					return MEVE_ERR_OUTOFSTACK;
-				}
+static MeveCode ShuntEnd(
+	MEVE_CONTEXT* ctx,
+	TSTACK* stack)
+{
+	MeveCode res;
 
-				ctx->expr.tk[ctx->expr.len].type = MEVE_TT_CONST;
-				ctx->expr.len++;
-			}
-			else
+	while (stack->top)
+	{
+		if (stack->top->type == MEVE_TT_OBRKT)
+		{
+			return MEVE_ERR_PARESNOTBALANCED;
+		}
+
+		if ((res = PostfixOut(ctx, stack->top)) != MEVE_ERR_OK)
+		{
+			return res;
+		}
+		StackPop(stack);
+	}
+
+	ctx->expr.top = ctx->expr.len ? &ctx->expr.tk[ctx->expr.len - 1] : NULL;
+	return MEVE_ERR_OK;
+}
+
+/* Reads the tokens of the input-string. Without an operator stack they
+ * are appended to ctx->expr as they are read, and with one they are fed
+ * to the shunting yard, so ctx->expr receives the postfix expression. */
+static MeveCode Lex(
+	MEVE_CONTEXT* ctx,
+	TSTACK* stack)
+{
+	const MTOKEN* prev = NULL;
+	MTOKEN last;
+	MTOKEN mul;
+	MeveCode res;
+
+	mul.type = MEVE_TT_OPR;
+	mul.data.opr = gOprMult;
+
+	for (size_t i = 0; i < ctx->strLen; i++)
+	{
+		KEYWORD_MATCH kw;
+		MTOKEN tk;
+		size_t len = 1;
+		bool implicitMul = false;
+
+		if (IsWhitespace(ctx->iStr[i]))
+		{
+			continue;
+		}
+		else if (IsDigit(ctx->iStr[i]))
+		{
+			tk.type = MEVE_TT_NUM;
+
+			if (!(len = StrToNum(&tk.data.val, &ctx->iStr[i])))
 			{
 				return MEVE_ERR_INVALIDEXPR;
 			}
-		}	
+
+			implicitMul = ImplicitMulNum(prev);
+		}
+		else if (IsVariable(&tk.data.var, ctx, &ctx->iStr[i], &len))
+		{
+			tk.type = MEVE_TT_VAR;
+			implicitMul = ImplicitMulVar(prev);
+		}
+		else if (IsOperator(&tk.data.opr, &kw, &ctx->iStr[i], UNARYCHECK(prev)))
+		{
+			tk.type = MEVE_TT_OPR;
+			len = strlen(tk.data.opr->str);
+		}
+		else if (IsOpenBrackets(ctx->iStr[i]))
+		{
+			tk.type = MEVE_TT_OBRKT;
+			implicitMul = ImplicitMulBrkt(prev);
+		}
+		else if (IsCloseBrackets(ctx->iStr[i]))
+		{
+			tk.type = MEVE_TT_CBRKT;
+		}
+		else if (IsDelimiter(ctx->iStr[i]))
+		{
+			tk.type = MEVE_TT_PARAMDELIM;
+		}
+		else if (IsFunction(&tk.data.fun, &kw))
+		{
+			tk.type = MEVE_TT_FUN;
+			len = strlen(tk.data.fun->str);
+			implicitMul = ImplicitMulFun(prev, tk.data.fun);
+		}
+		else if (IsConstant(&tk.data.cst, &kw))
+		{
+			tk.type = MEVE_TT_CONST;
+			len = strlen(tk.data.cst->str);
+			implicitMul = ImplicitMulConst(prev);
+		}
+		else
+		{
+			return MEVE_ERR_INVALIDEXPR;
+		}
+
+		if (implicitMul)
+		{
+			res = stack ? ShuntToken(ctx, stack, &mul) : PostfixOut(ctx, &mul);
+
+			if (res != MEVE_ERR_OK)
+			{
+				return res;
+			}
+			STATS_ADD(ctx, implicitMuls, 1);
+		}
+
+		STATS_ADD(ctx, tokens, 1);
+		res = stack ? ShuntToken(ctx, stack, &tk) : PostfixOut(ctx, &tk);
+
+		if (res != MEVE_ERR_OK)
+		{
+			return res;
+		}
+
+		last = tk;
+		prev = &last;
+		i += len - 1;
+	}
+	return MEVE_ERR_OK;
+}
+
+MeveCode CreateTokens(
+	MEVE_CONTEXT* ctx)
+{
+	MeveCode res;
+
+	if (!ctx || !ctx->iStr)
+	{
+		return MEVE_ERR_INVALIDPARAM;
 	}
 
-	ctx->expr.top = &ctx->expr.tk[ctx->expr.len - 1];
+	if (!ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDSIZE;
+	}
+
+	STATS_BEGIN(ticks);
+	res = Lex(ctx, NULL);
+	STATS_END(ctx, MEVE_STAGE_TOKENS, ticks);
+
+	if (res != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	ctx->expr.top = ctx->expr.len ? &ctx->expr.tk[ctx->expr.len - 1] : NULL;
 
 	return MEVE_ERR_OK;
 }
@@ -464,6 +1135,7 @@ MeveCode InfixToPostfix(
 {
 	TSTACK stack;
 	MTOKEN tBuffer[MAXLEN_TBUFFER];
+	MeveCode res = MEVE_ERR_OK;
 
 	if (!ctx)
 	{
@@ -472,90 +1144,174 @@ MeveCode InfixToPostfix(
 
 	StackInit(&stack, tBuffer, MAXSIZE_TBUFFER);
 
+	const size_t len = ctx->expr.len;
+
+	STATS_BEGIN(ticks);
+
+	/* The output is written over the tokens already read. */
+	ctx->expr.len = 0;
+
+	for (size_t i = 0; i < len && res == MEVE_ERR_OK; i++)
+	{
+		const MTOKEN tk = ctx->expr.tk[i];
+
+		res = ShuntToken(ctx, &stack, &tk);
+	}
+
+	if (res == MEVE_ERR_OK)
+	{
+		res = ShuntEnd(ctx, &stack);
+	}
+
+	STATS_END(ctx, MEVE_STAGE_POSTFIX, ticks);
+	return res;
+}
+
+static num_t TokenValue(
+	const MTOKEN* tk)
+{
+	return tk->type == MEVE_TT_CONST ? tk->data.cst->cVal : tk->data.val;
+}
+
+static bool IsTokenValue(
+	const MTOKEN* tk,
+	const bool cst,
+	const num_t val)
+{
+	return cst && TokenValue(tk) == val && !signbit(TokenValue(tk));
+}
+
+MeveCode PostfixOptimize(
+	MEVE_CONTEXT* ctx)
+{
+	size_t start[MAXLEN_TBUFFER];
+	bool cst[MAXLEN_TBUFFER];
+	num_t arg[MEVE_MAX_FUN_ARITY];
+	size_t sp = 0;
 	size_t len = 0;
+	size_t i;
 
-	for (size_t i = 0; i < ctx->expr.len; i++)
+	if (!ctx)
 	{
-		switch (ctx->expr.tk[i].type)
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	STATS_BEGIN(ticks);
+
+	/* Each stack entry holds where an operand starts in the output and
+	 * whether it is a single number token. */
+	for (i = 0; i < ctx->expr.len; i++)
+	{
+		MTOKEN* tk = &ctx->expr.tk[i];
+		size_t arity = 0;
+
+		if (tk->type == MEVE_TT_OPR)
 		{
-			case MEVE_TT_CONST:
-			case MEVE_TT_NUM:
-			{
-				ctx->expr.tk[len++] = ctx->expr.tk[i];
-				break;
-			}
-			case MEVE_TT_FUN:
-			{
-				StackPush(&stack, &ctx->expr.tk[i]);
-				break;
-			}
-			case MEVE_TT_OPR:
-			{
-				while (STACKISDONE(stack.top, ctx->expr.tk[i]))
-				{
-					ctx->expr.tk[len++] = *stack.top;
-					StackPop(&stack);					
-				}
+			arity = tk->data.opr->prec == OPR_P_UNARY ? 1 : 2;
+		}
+		else if (tk->type == MEVE_TT_FUN)
+		{
+			arity = tk->data.fun->arity;
+		}
 
-				StackPush(&stack, &ctx->expr.tk[i]);
-				break;
-			}
-			case MEVE_TT_OBRKT:
-			{
-				StackPush(&stack, &ctx->expr.tk[i]);
-				break;
-			}
-			case MEVE_TT_CBRKT:
-			{
-				while (stack.top && stack.top->type != MEVE_TT_OBRKT)
-				{
-					/* Discard parameter delimiters */
-					if (stack.top->type != MEVE_TT_PARAMDELIM)
-					{
-						ctx->expr.tk[len++] = *stack.top;
-					}
-					StackPop(&stack);
-				}
-				StackPop(&stack);
-				break;
-			}
-			case MEVE_TT_PARAMDELIM:
+		if (sp < arity || sp == MAXLEN_TBUFFER)
+		{
+			break;
+		}
+
+		if (tk->type == MEVE_TT_NUM || tk->type == MEVE_TT_CONST ||
+			tk->type == MEVE_TT_VAR || tk->type == MEVE_TT_PARAM)
+		{
+			start[sp] = len;
+			cst[sp++] = tk->type == MEVE_TT_NUM || tk->type == MEVE_TT_CONST;
+			ctx->expr.tk[len++] = *tk;
+			continue;
+		}
+		else if (tk->type != MEVE_TT_OPR && tk->type != MEVE_TT_FUN)
+		{
+			break;
+		}
+
+		num_t(*fPtr)(const num_t*) = tk->type == MEVE_TT_OPR ? tk->data.opr->fPtr : tk->data.fun->fPtr;
+		const uint8_t op = tk->type == MEVE_TT_OPR ? tk->data.opr->op : tk->data.fun->op;
+		bool folded = true;
+
+		for (size_t j = 0; j < arity; j++)
+		{
+			folded = folded && cst[sp - arity + j];
+		}
+
+		if (folded)
+		{
+			for (size_t j = 0; j < arity; j++)
 			{
-				while (stack.top &&
-					stack.top->type != MEVE_TT_OBRKT &&
-					stack.top->type != MEVE_TT_PARAMDELIM)
-				{
-					ctx->expr.tk[len++] = *stack.top;
-					StackPop(&stack);
-				}
-				break;
+				arg[j] = TokenValue(&ctx->expr.tk[start[sp - arity + j]]);
 			}
-			default:
+
+			sp -= arity;
+			len = start[sp];
+			STATS_ADD(ctx, calls[op], 1);
+			ctx->expr.tk[len].data.val = fPtr(arg);
+			ctx->expr.tk[len].type = MEVE_TT_NUM;
+			start[sp] = len++;
+			cst[sp++] = true;
+		}
+		else if (op == MEVE_OP_POS)
+		{
+			/* Explicitly left empty: the operand is the result. */
+		}
+		else if ((op == MEVE_OP_MUL || op == MEVE_OP_DIV) &&
+			IsTokenValue(&ctx->expr.tk[start[sp - 1]], cst[sp - 1], 1))
+		{
+			len--;
+			sp--;
+		}
+		else if (op == MEVE_OP_SUB &&
+			IsTokenValue(&ctx->expr.tk[start[sp - 1]], cst[sp - 1], 0))
+		{
+			len--;
+			sp--;
+		}
+		else if (op == MEVE_OP_MUL &&
+			IsTokenValue(&ctx->expr.tk[start[sp - 2]], cst[sp - 2], 1))
+		{
+			memmove(&ctx->expr.tk[start[sp - 2]],
+				&ctx->expr.tk[start[sp - 1]],
+				(len - start[sp - 1]) * sizeof(MTOKEN));
+			len--;
+			sp--;
+			cst[sp - 1] = cst[sp];
+		}
+		else
+		{
+			sp -= arity;
+
+			if (!arity)
 			{
-				/* Explicitly left empty */
+				start[sp] = len;
 			}
+
+			ctx->expr.tk[len++] = *tk;
+			cst[sp++] = false;
 		}
 	}
 
-	while (stack.top)
+	/* Whatever could not be optimized is kept as it is. */
+	for (; i < ctx->expr.len; i++)
 	{
-		ctx->expr.tk[len++] = *stack.top;
-		StackPop(&stack);
+		ctx->expr.tk[len++] = ctx->expr.tk[i];
 	}
+
 	ctx->expr.top = len ? &ctx->expr.tk[len - 1] : NULL;
 	ctx->expr.len = len;
 
+	STATS_END(ctx, MEVE_STAGE_OPTIMIZE, ticks);
 	return MEVE_ERR_OK;
 }
 
-MeveCode PostfixEval(
+static MeveCode PostfixRun(
 	MEVE_CONTEXT* ctx)
 {
-	if (!ctx)
-	{
-		return MEVE_ERR_INVALIDPARAM;
-	}
-
 	TSTACK stack;
 	MTOKEN tBuffer[MAXLEN_TBUFFER];
 	num_t arg[MEVE_MAX_FUN_ARITY];
@@ -564,6 +1320,15 @@ MeveCode PostfixEval(
 
 	for (size_t i = 0; i < ctx->expr.len; i++)
 	{
+		/* Only operands make the stack grow. */
+		if ((ctx->expr.tk[i].type == MEVE_TT_CONST ||
+			ctx->expr.tk[i].type == MEVE_TT_VAR ||
+			ctx->expr.tk[i].type == MEVE_TT_NUM) &&
+			!StackReserve(ctx->arena, &stack, 1))
+		{
+			return MEVE_ERR_OUTOFSTACK;
+		}
+
 		switch (ctx->expr.tk[i].type)
 		{
 			case MEVE_TT_CONST:
@@ -573,6 +1338,11 @@ MeveCode PostfixEval(
 				stack.top->type = MEVE_TT_NUM;
 				break;
 			}
+			case MEVE_TT_VAR:
+			{
+				StackPushNum(&stack, *ctx->expr.tk[i].data.var->ptr);
+				break;
+			}
 			case MEVE_TT_NUM:
 			{
 				StackPush(&stack, &ctx->expr.tk[i]);
@@ -599,6 +1369,7 @@ MeveCode PostfixEval(
 				arg[0] = stack.top->data.val;
 				StackPop(&stack);
 
+				STATS_ADD(ctx, calls[ctx->expr.tk[i].data.opr->op], 1);
 				StackPushNum(&stack, ctx->expr.tk[i].data.opr->fPtr(arg));
 				break;
 			}
@@ -615,6 +1386,7 @@ MeveCode PostfixEval(
 					StackPop(&stack);
 				}
 
+				STATS_ADD(ctx, calls[ctx->expr.tk[i].data.fun->op], 1);
 				StackPushNum(&stack, ctx->expr.tk[i].data.opr->fPtr(arg));
 				break;
 			}
@@ -623,6 +1395,8 @@ MeveCode PostfixEval(
 				/* Explicitly left empty. */
 			}
 		}
+
+		STATS_MAX(ctx, maxDepth, stack.len);
 	}
 
 	if (stack.len != 1)
@@ -634,7 +1408,25 @@ MeveCode PostfixEval(
 	return MEVE_ERR_OK;
 }
 
-bool AreParanthesesBalanced(
+MeveCode PostfixEval(
+	MEVE_CONTEXT* ctx)
+{
+	MeveCode res;
+
+	if (!ctx)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	STATS_BEGIN(ticks);
+	res = PostfixRun(ctx);
+	STATS_END(ctx, MEVE_STAGE_EVAL, ticks);
+	STATS_ADD(ctx, evalTokens, ctx->expr.len);
+
+	return res;
+}
+
+static bool AreParanthesesBalanced(
 	const char* iStr,
 	const size_t len)
 {
@@ -659,27 +1451,59 @@ bool AreParanthesesBalanced(
 	return (bool)!pCount;
 }
 
-MeveCode EvalString(
+MeveCode CreatePostfix(
 	MEVE_CONTEXT* ctx)
 {
+	TSTACK stack;
+	MTOKEN tBuffer[MAXLEN_TBUFFER];
 	MeveCode res;
 
-	if (!ctx || !ctx->iStr || !ctx->strLen)
+	if (!ctx || !ctx->iStr)
 	{
 		return MEVE_ERR_INVALIDPARAM;
 	}
 
-	if (!AreParanthesesBalanced(ctx->iStr, ctx->strLen))
+	if (!ctx->strLen)
 	{
-		return MEVE_ERR_PARESNOTBALANCED;
+		return MEVE_ERR_INVALIDSIZE;
+	}
+
+	StackInit(&stack, tBuffer, MAXSIZE_TBUFFER);
+	STATS_BEGIN(ticks);
+
+	if ((res = Lex(ctx, &stack)) == MEVE_ERR_OK)
+	{
+		res = ShuntEnd(ctx, &stack);
+	}
+
+	STATS_END(ctx, MEVE_STAGE_PARSE, ticks);
+
+	/* Unbalanced brackets are reported before any other error, as when
+	 * they are checked ahead of the tokens. */
+	if (res != MEVE_ERR_OK && res != MEVE_ERR_PARESNOTBALANCED &&
+		!AreParanthesesBalanced(ctx->iStr, ctx->strLen))
+	{
+		res = MEVE_ERR_PARESNOTBALANCED;
+	}
+	return res;
+}
+
+MeveCode EvalString(
+	MEVE_CONTEXT* ctx)
+{
+	MeveCode res;
+
+	if (!ctx || !ctx->iStr || !ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDPARAM;
 	}
 
-	if ((res = CreateTokens(ctx)) != MEVE_ERR_OK)
+	if ((res = CreatePostfix(ctx)) != MEVE_ERR_OK)
 	{
 		return res;
 	}
 
-	if ((res = InfixToPostfix(ctx)) != MEVE_ERR_OK)
+	if ((res = PostfixOptimize(ctx)) != MEVE_ERR_OK)
 	{
 		return res;
 	}
@@ -692,23 +1516,1348 @@ MeveCode EvalString(
 	return res;
 }
 
-void MeveInit(
-	MEVE_CONTEXT* ctx,
-	MTOKEN* tkBuff,
-	size_t buffSz,
-	const char* iStr)
+static MeveCode PostfixDepth(
+	const TSTACK* expr,
+	size_t* depth)
 {
-	ctx->iStr = iStr;
-	ctx->strLen = strlen(ctx->iStr);
-	ctx->ans = 0;
-	ctx->expr.tk = tkBuff;
-	ctx->expr.sz = buffSz;
-	StackClear(&ctx->expr);
-}
+	size_t len = 0;
+
+	*depth = 0;
+
+	for (size_t i = 0; i < expr->len; i++)
+	{
+		size_t arity;
+
+		switch (expr->tk[i].type)
+		{
+			case MEVE_TT_CONST:
+			case MEVE_TT_VAR:
+			case MEVE_TT_PARAM:
+			case MEVE_TT_NUM:
+			{
+				arity = 0;
+				break;
+			}
+			case MEVE_TT_OPR:
+			{
+				arity = expr->tk[i].data.opr->prec == OPR_P_UNARY ? 1 : 2;
+				break;
+			}
+			case MEVE_TT_FUN:
+			{
+				arity = expr->tk[i].data.fun->arity;
+				break;
+			}
+			default:
+			{
+				return MEVE_ERR_INVALIDEXPR;
+			}
+		}
+
+		if (len < arity)
+		{
+			return MEVE_ERR_INVALIDEXPR;
+		}
+
+		len = len - arity + 1;
+
+		if (len > *depth)
+		{
+			*depth = len;
+		}
+	}
+
+	return len == 1 ? MEVE_ERR_OK : MEVE_ERR_INVALIDEXPR;
+}
+
+static uint16_t PoolConst(
+	MEVE_PROGRAM* prog,
+	const num_t val)
+{
+	/* The parameters are not shared with the constants. */
+	for (size_t i = prog->pLen; i < prog->kLen; i++)
+	{
+		if (prog->kPool[i] == val && signbit(prog->kPool[i]) == signbit(val))
+		{
+			return (uint16_t)i;
+		}
+	}
+
+	prog->kPool[prog->kLen] = val;
+	return (uint16_t)prog->kLen++;
+}
+
+static uint16_t PoolCallback(
+	MEVE_PROGRAM* prog,
+	num_t(*fPtr)(const num_t*))
+{
+	for (size_t i = 0; i < prog->fLen; i++)
+	{
+		if (prog->fPool[i] == fPtr)
+		{
+			return (uint16_t)i;
+		}
+	}
+
+	prog->fPool[prog->fLen] = fPtr;
+	return (uint16_t)prog->fLen++;
+}
+
+/* Allocates the pools and streams of a program in a single block, which
+ * starts with the constant pool. Each array is aligned to the size of its
+ * elements. */
+static bool ProgramAlloc(
+	MEVE_PROGRAM* prog,
+	const size_t kLen,
+	const size_t fLen,
+	const size_t aLen,
+	const size_t len)
+{
+	const size_t fOff = (kLen * sizeof(num_t) + sizeof(*prog->fPool) - 1) /
+		sizeof(*prog->fPool) * sizeof(*prog->fPool);
+	const size_t aOff = fOff + fLen * sizeof(*prog->fPool);
+	const size_t oOff = aOff + aLen * sizeof(uint16_t);
+	uint8_t* mem = malloc(oOff + len + 1);
+
+	if (!mem)
+	{
+		return false;
+	}
+
+	prog->kPool = (num_t*)mem;
+	prog->fPool = (void*)&mem[fOff];
+	prog->args = (uint16_t*)&mem[aOff];
+	prog->ops = &mem[oOff];
+	return true;
+}
+
+static uint32_t ShareHash(
+	const uint8_t op,
+	const uint16_t arg,
+	const uint32_t a,
+	const uint32_t b)
+{
+	uint32_t h = (op * UINT32_C(0x9E3779B1)) ^ arg;
+
+	h = (h ^ a) * UINT32_C(0x85EBCA6B);
+	h = (h ^ b) * UINT32_C(0xC2B2AE35);
+	return h ^ (h >> 16);
+}
+
+/* Returns the node of an operation code on two operands, creating it
+ * unless an equal node exists. */
+static uint32_t ShareNode(
+	SHARE_DAG* dag,
+	const uint8_t op,
+	const uint16_t arg,
+	const uint32_t a,
+	const uint32_t b)
+{
+	/* Callbacks may have side effects, so every call is kept. */
+	const bool call = op == MEVE_OP_CALL1 || op == MEVE_OP_CALL2;
+	size_t h = 0;
+	uint32_t n;
+
+	if (!call)
+	{
+		for (h = ShareHash(op, arg, SHARE_FIRST(op, a, b), SHARE_SECOND(op, a, b)) & (dag->hLen - 1);
+			dag->table[h]; h = (h + 1) & (dag->hLen - 1))
+		{
+			const SHARE_NODE* v = &dag->node[dag->table[h] - 1];
+
+			if (v->op == op && v->arg == arg &&
+				SHARE_FIRST(op, v->a, v->b) == SHARE_FIRST(op, a, b) &&
+				SHARE_SECOND(op, v->a, v->b) == SHARE_SECOND(op, a, b))
+			{
+				return dag->table[h] - 1;
+			}
+		}
+	}
+
+	n = (uint32_t)dag->nLen++;
+	dag->node[n].a = a;
+	dag->node[n].b = b;
+	dag->node[n].uses = 0;
+	dag->node[n].arg = arg;
+	dag->node[n].slot = UINT16_MAX;
+	dag->node[n].op = op;
+
+	if (!call)
+	{
+		dag->table[h] = n + 1;
+	}
+
+	if (a != SHARE_NONE && ++dag->node[a].uses > 1 && MEVE_OP_ARITY(dag->node[a].op))
+	{
+		dag->shared = true;
+	}
+
+	if (b != SHARE_NONE && ++dag->node[b].uses > 1 && MEVE_OP_ARITY(dag->node[b].op))
+	{
+		dag->shared = true;
+	}
+	return n;
+}
+
+/* Rewrites a power or a division by a constant into cheaper nodes, or
+ * returns SHARE_NONE. The parameters are never constants here, since
+ * they can change after compiling. */
+static uint32_t ShareRewrite(
+	SHARE_DAG* dag,
+	MEVE_PROGRAM* prog,
+	const uint32_t flags,
+	const uint8_t op,
+	const uint32_t a,
+	const uint32_t b)
+{
+	const SHARE_NODE* k = b != SHARE_NONE ? &dag->node[b] : NULL;
+	uint32_t r = SHARE_NONE;
+	uint32_t sq;
+	num_t c;
+
+	if (!dag->rewrite || !k || k->op != MEVE_OP_PUSHK || k->arg < prog->pLen)
+	{
+		return SHARE_NONE;
+	}
+
+	c = prog->kPool[k->arg];
+
+	if (op == MEVE_OP_DIV)
+	{
+		/* The reciprocal of a power of two is exact when it is a normal
+		 * number, and the product is then rounded like the quotient. */
+		const num_t inv = 1 / c;
+		int e;
+
+		if (!isfinite(c) || c == 0 || !isnormal(inv))
+		{
+			return SHARE_NONE;
+		}
+
+		if (!(flags & MEVE_FLAG_FASTMATH) &&
+			(MEVE_MATH(fabs)(MEVE_MATH(frexp)(c, &e)) != (num_t)0.5 || 1 / inv != c))
+		{
+			return SHARE_NONE;
+		}
+		return ShareNode(dag, MEVE_OP_MUL, 0, a, ShareNode(dag, MEVE_OP_PUSHK, PoolConst(prog, inv), SHARE_NONE, SHARE_NONE));
+	}
+	else if (op != MEVE_OP_POW || !(flags & MEVE_FLAG_FASTMATH))
+	{
+		return SHARE_NONE;
+	}
+	else if (c == (num_t)0.5)
+	{
+		return ShareNode(dag, MEVE_OP_SQRT, 0, a, SHARE_NONE);
+	}
+	else if (c != MEVE_MATH(trunc)(c) || c == 0 || MEVE_MATH(fabs)(c) > SHARE_MAXPOW)
+	{
+		return SHARE_NONE;
+	}
+
+	/* Exponentiation by squaring; the squares read more than once are
+	 * then kept in temporaries. A negative power squares the reciprocal,
+	 * since x^|n| can overflow where x^n is still a number. */
+	sq = c > 0 ? a :
+		ShareNode(dag, MEVE_OP_DIV, 0, ShareNode(dag, MEVE_OP_PUSHK, PoolConst(prog, 1), SHARE_NONE, SHARE_NONE), a);
+
+	for (uint32_t n = (uint32_t)MEVE_MATH(fabs)(c); n; n >>= 1)
+	{
+		if (n & 1)
+		{
+			r = r == SHARE_NONE ? sq : ShareNode(dag, MEVE_OP_MUL, 0, r, sq);
+		}
+
+		if (n > 1)
+		{
+			sq = ShareNode(dag, MEVE_OP_MUL, 0, sq, sq);
+		}
+	}
+	return r;
+}
+
+/* Evaluates the repeated subexpressions of a program once. The stream is
+ * hash-consed into a DAG, where equal operators on equal operands are one
+ * node, and emitted again in the same order: the first occurrence of an
+ * operator node read more than once is stored to a temporary slot, and
+ * the next ones are loaded from it.
+ * Divisions by powers of two become exact multiplications and, with
+ * MEVE_FLAG_FASTMATH, the other divisions by constants and the powers
+ * with constant exponents are rewritten as well. The DAG is complete
+ * before the stream is emitted, so the stream is rewritten in place.
+ * The DAG has at most nCap nodes, and prog must have room for
+ * SHARE_MAXLEN(nCap) operation codes and operands and for nCap constants.
+ * Rewrites are only made when nCap leaves SHARE_GROWTH nodes for each
+ * power and division. */
+static MeveCode ProgramShare(
+	MEVE_PROGRAM* prog,
+	const uint32_t flags,
+	const size_t nCap,
+	size_t* depth)
+{
+	const size_t len = prog->len;
+	size_t kLen;
+	size_t sp = 0;
+	size_t cur = 0;
+	size_t fLen = 0;
+	bool rewritten = false;
+	const uint16_t* ap = prog->args;
+	SHARE_DAG dag;
+	uint32_t* stack;
+	uint16_t* freeSlot;
+	uint16_t* kMap;
+
+	dag.hLen = 16;
+	dag.nLen = 0;
+	dag.rewrite = nCap > len;
+	dag.shared = false;
+
+	while (dag.hLen < 2 * nCap)
+	{
+		dag.hLen <<= 1;
+	}
+
+	/* Each expanded node pushes at most three entries and pops one, so
+	 * the work stack never exceeds 2 * nCap + 1 entries. */
+	if (!(dag.node = malloc(nCap * sizeof(SHARE_NODE) + (dag.hLen + 2 * nCap + 1) * sizeof(uint32_t) +
+		2 * nCap * sizeof(uint16_t))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	dag.table = (uint32_t*)&dag.node[nCap];
+	stack = &dag.table[dag.hLen];
+	freeSlot = (uint16_t*)&stack[2 * nCap + 1];
+	kMap = &freeSlot[nCap];
+	memset(dag.table, 0, dag.hLen * sizeof(uint32_t));
+
+	for (size_t i = 0; i < len; i++)
+	{
+		const uint8_t op = prog->ops[i];
+		const uint16_t arg = MEVE_OP_HAS_ARG(op) ? *ap++ : 0;
+		const size_t arity = MEVE_OP_ARITY(op);
+		const uint32_t b = arity == 2 ? stack[--sp] : SHARE_NONE;
+		const uint32_t a = arity >= 1 ? stack[--sp] : SHARE_NONE;
+		uint32_t n = ShareRewrite(&dag, prog, flags, op, a, b);
+
+		if (n == SHARE_NONE)
+		{
+			n = ShareNode(&dag, op, arg, a, b);
+		}
+		else
+		{
+			rewritten = true;
+		}
+
+		stack[sp++] = n;
+	}
+
+	if (!dag.shared && !rewritten)
+	{
+		free(dag.node);
+		return MEVE_ERR_OK;
+	}
+
+	prog->len = 0;
+	prog->aLen = 0;
+	prog->tLen = 0;
+	*depth = 0;
+	kLen = prog->kLen;
+
+	/* The constants only read by rewritten nodes are dropped from the
+	 * pool. The others keep their order, so they are moved down in place;
+	 * the parameters keep their indices. */
+	for (size_t i = 0; i < kLen; i++)
+	{
+		kMap[i] = i < prog->pLen ? (uint16_t)i : UINT16_MAX;
+	}
+
+	for (size_t i = 0; i < dag.nLen; i++)
+	{
+		if (dag.node[i].op == MEVE_OP_PUSHK && dag.node[i].arg >= prog->pLen &&
+			(dag.node[i].uses || i == stack[0]))
+		{
+			kMap[dag.node[i].arg] = 0;
+		}
+	}
+
+	for (size_t i = prog->kLen = prog->pLen; i < kLen; i++)
+	{
+		if (kMap[i] != UINT16_MAX)
+		{
+			prog->kPool[prog->kLen] = prog->kPool[i];
+			kMap[i] = (uint16_t)prog->kLen++;
+		}
+	}
+
+	/* The root is left alone on the stack. */
+	sp = 1;
+
+	while (sp)
+	{
+		const uint32_t e = stack[--sp];
+		SHARE_NODE* v = &dag.node[e & ~SHARE_EXPANDED];
+		const size_t arity = MEVE_OP_ARITY(v->op);
+
+		if (v->slot != UINT16_MAX)
+		{
+			/* A later occurrence, read from its slot. */
+			prog->ops[prog->len++] = MEVE_OP_LOADT;
+			prog->args[prog->aLen++] = v->slot;
+			cur++;
+
+			if (!--v->uses)
+			{
+				freeSlot[fLen++] = v->slot;
+			}
+		}
+		else if (arity && !(e & SHARE_EXPANDED))
+		{
+			stack[sp++] = e | SHARE_EXPANDED;
+
+			if (arity == 2)
+			{
+				stack[sp++] = v->b;
+			}
+			stack[sp++] = v->a;
+			continue;
+		}
+		else
+		{
+			prog->ops[prog->len++] = v->op;
+
+			if (MEVE_OP_HAS_ARG(v->op))
+			{
+				prog->args[prog->aLen++] = v->op == MEVE_OP_PUSHK ? kMap[v->arg] : v->arg;
+			}
+			cur = cur + 1 - arity;
+
+			/* The first occurrence of a shared operator, stored to a slot
+			 * freed by an earlier one if possible. */
+			if (arity && v->uses > 1)
+			{
+				v->slot = fLen ? freeSlot[--fLen] : (uint16_t)prog->tLen++;
+				v->uses--;
+				prog->ops[prog->len++] = MEVE_OP_STORE;
+				prog->args[prog->aLen++] = v->slot;
+			}
+		}
+
+		if (cur > *depth)
+		{
+			*depth = cur;
+		}
+	}
+
+	free(dag.node);
+	return MEVE_ERR_OK;
+}
+
+static MeveCode ProgramEmit(
+	const MEVE_CONTEXT* ctx,
+	MEVE_PROGRAM* prog,
+	size_t depth)
+{
+	const size_t len = ctx->expr.len;
+	MEVE_PROGRAM tmp = *prog;
+	size_t nCap = len;
+	size_t sLen = len;
+	MeveCode res;
+
+	if (len > UINT16_MAX || ctx->varCount > UINT16_MAX)
+	{
+		return MEVE_ERR_INVALIDSIZE;
+	}
+
+	/* Each power and division may be rewritten into SHARE_GROWTH nodes,
+	 * as long as the slots and constants still fit in their operands. */
+	for (size_t i = 0; i < len; i++)
+	{
+		const MTOKEN* tk = &ctx->expr.tk[i];
+
+		if (tk->type == MEVE_TT_OPR && (tk->data.opr->op == MEVE_OP_POW || tk->data.opr->op == MEVE_OP_DIV))
+		{
+			nCap += SHARE_GROWTH;
+		}
+	}
+
+	if (nCap > UINT16_MAX)
+	{
+		nCap = len;
+	}
+	else if (nCap > len)
+	{
+		sLen = SHARE_MAXLEN(nCap);
+	}
+
+	/* The program is emitted into a block sized for the tokens and their
+	 * rewrites, then packed into one of its exact size. */
+	if (!ProgramAlloc(&tmp, nCap, len, sLen, sLen))
+	{
+		MeveFree(prog);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	/* The parameters, if any, were bound by MeveCompileParams(). */
+	if (prog->kPool)
+	{
+		memcpy(tmp.kPool, prog->kPool, prog->kLen * sizeof(num_t));
+		free(prog->kPool);
+		prog->kPool = NULL;
+	}
+
+	for (size_t i = 0; i < len; i++)
+	{
+		const MTOKEN* tk = &ctx->expr.tk[i];
+		uint8_t op;
+		uint16_t arg = 0;
+
+		switch (tk->type)
+		{
+			case MEVE_TT_CONST:
+			case MEVE_TT_NUM:
+			{
+				op = MEVE_OP_PUSHK;
+				arg = PoolConst(&tmp, TokenValue(tk));
+				break;
+			}
+			case MEVE_TT_PARAM:
+			{
+				op = MEVE_OP_PUSHK;
+				arg = (uint16_t)tk->data.param;
+				break;
+			}
+			case MEVE_TT_VAR:
+			{
+				op = MEVE_OP_LOADV;
+				arg = (uint16_t)(tk->data.var - ctx->vars);
+				break;
+			}
+			case MEVE_TT_OPR:
+			case MEVE_TT_FUN:
+			{
+				const MEVE_OPR* opr = tk->data.opr;
+				const MEVE_FUN* fun = tk->data.fun;
+
+				op = tk->type == MEVE_TT_OPR ? opr->op : fun->op;
+
+				if (op == MEVE_OP_CALL1 || op == MEVE_OP_CALL2)
+				{
+					arg = PoolCallback(&tmp, tk->type == MEVE_TT_OPR ? opr->fPtr : fun->fPtr);
+				}
+				break;
+			}
+			default:
+			{
+				continue;
+			}
+		}
+
+		/* Unary plus does not change its operand. */
+		if (op == MEVE_OP_POS)
+		{
+			continue;
+		}
+
+		tmp.ops[tmp.len++] = op;
+
+		if (MEVE_OP_HAS_ARG(op))
+		{
+			tmp.args[tmp.aLen++] = arg;
+		}
+	}
+
+	if ((res = ProgramShare(&tmp, ctx->flags, nCap, &depth)) != MEVE_ERR_OK)
+	{
+		free(tmp.kPool);
+		MeveFree(prog);
+		return res;
+	}
+
+	if (!ProgramAlloc(prog, tmp.kLen, tmp.fLen, tmp.aLen, tmp.len))
+	{
+		free(tmp.kPool);
+		MeveFree(prog);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	memcpy(prog->kPool, tmp.kPool, tmp.kLen * sizeof(num_t));
+	memcpy(prog->fPool, tmp.fPool, tmp.fLen * sizeof(*tmp.fPool));
+	memcpy(prog->args, tmp.args, tmp.aLen * sizeof(uint16_t));
+	memcpy(prog->ops, tmp.ops, tmp.len);
+	prog->ops[tmp.len] = MEVE_OP_RET;
+	prog->len = tmp.len;
+	prog->aLen = tmp.aLen;
+	prog->kLen = tmp.kLen;
+	prog->fLen = tmp.fLen;
+	prog->depth = depth;
+	prog->tLen = tmp.tLen;
+	free(tmp.kPool);
+
+	return MEVE_ERR_OK;
+}
+
+static void ProgramInit(
+	const MEVE_CONTEXT* ctx,
+	MEVE_PROGRAM* prog)
+{
+	prog->ops = NULL;
+	prog->len = 0;
+	prog->args = NULL;
+	prog->aLen = 0;
+	prog->kPool = NULL;
+	prog->kLen = 0;
+	prog->pLen = 0;
+	prog->fPool = NULL;
+	prog->fLen = 0;
+	prog->depth = 0;
+	prog->tLen = 0;
+	prog->vars = ctx->vars;
+	prog->varCount = ctx->varCount;
+}
+
+static MeveCode ProgramBuild(
+	MEVE_CONTEXT* ctx,
+	MEVE_PROGRAM* prog)
+{
+	MeveCode res;
+	size_t depth;
+
+	if ((res = PostfixOptimize(ctx)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	if ((res = PostfixDepth(&ctx->expr, &depth)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	return ProgramEmit(ctx, prog, depth);
+}
+
+MeveCode MeveCompile(
+	MEVE_CONTEXT* ctx,
+	MEVE_PROGRAM* prog)
+{
+	MeveCode res;
+
+	if (!ctx || !prog || !ctx->iStr || !ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	ProgramInit(ctx, prog);
+	StackClear(&ctx->expr);
+
+	if ((res = CreatePostfix(ctx)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	return ProgramBuild(ctx, prog);
+}
+
+MeveCode MeveCompileParams(
+	MEVE_CONTEXT* ctx,
+	MEVE_PROGRAM* prog)
+{
+	MeveCode res;
+
+	if (!ctx || !prog || !ctx->iStr || !ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	ProgramInit(ctx, prog);
+
+	if (!AreParanthesesBalanced(ctx->iStr, ctx->strLen))
+	{
+		return MEVE_ERR_PARESNOTBALANCED;
+	}
+
+	/* The pool is sized for the tokens, which are never fewer than the
+	 * instructions, and starts with the literals in input order. */
+	if (!(prog->kPool = malloc((ctx->expr.len + 1) * sizeof(num_t))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	for (size_t i = 0; i < ctx->expr.len; i++)
+	{
+		MTOKEN* tk = &ctx->expr.tk[i];
+
+		if (tk->type == MEVE_TT_NUM)
+		{
+			prog->kPool[prog->pLen] = tk->data.val;
+			tk->data.param = prog->pLen++;
+			tk->type = MEVE_TT_PARAM;
+		}
+	}
+	prog->kLen = prog->pLen;
+
+	if ((res = InfixToPostfix(ctx)) != MEVE_ERR_OK ||
+		(res = ProgramBuild(ctx, prog)) != MEVE_ERR_OK)
+	{
+		MeveFree(prog);
+	}
+	return res;
+}
+
+#if defined(__GNUC__) && !defined(MEVE_NO_COMPUTED_GOTO)
+#define VM_LABEL(op)			[op] = &&L_##op
+#define VM_CASE(op)				L_##op:
+#define VM_DISPATCH				__extension__ ({ goto *labels[*pc]; });
+#define VM_NEXT					__extension__ ({ pc++; goto *labels[*pc]; })
+#else
+#define VM_CASE(op)				case op:
+#define VM_DISPATCH				for (;; pc++) switch (*pc)
+#define VM_NEXT					continue
+#endif
+
+MeveCode MeveRun(
+	const MEVE_PROGRAM* prog,
+	num_t* res)
+{
+#if defined(__GNUC__) && !defined(MEVE_NO_COMPUTED_GOTO)
+	__extension__ static const void* const labels[MEVE_OP_COUNT] =
+	{
+		VM_LABEL(MEVE_OP_RET),
+		VM_LABEL(MEVE_OP_PUSHK),
+		VM_LABEL(MEVE_OP_LOADV),
+		VM_LABEL(MEVE_OP_LOADT),
+		VM_LABEL(MEVE_OP_POS),
+		VM_LABEL(MEVE_OP_STORE),
+		VM_LABEL(MEVE_OP_NEG),
+		VM_LABEL(MEVE_OP_EXP),
+		VM_LABEL(MEVE_OP_SQRT),
+		VM_LABEL(MEVE_OP_ABS),
+		VM_LABEL(MEVE_OP_SIN),
+		VM_LABEL(MEVE_OP_COS),
+		VM_LABEL(MEVE_OP_TAN),
+		VM_LABEL(MEVE_OP_ASIN),
+		VM_LABEL(MEVE_OP_ACOS),
+		VM_LABEL(MEVE_OP_ATAN),
+		VM_LABEL(MEVE_OP_LOG10),
+		VM_LABEL(MEVE_OP_LOG),
+		VM_LABEL(MEVE_OP_FACT),
+		VM_LABEL(MEVE_OP_CALL1),
+		VM_LABEL(MEVE_OP_ADD),
+		VM_LABEL(MEVE_OP_SUB),
+		VM_LABEL(MEVE_OP_MUL),
+		VM_LABEL(MEVE_OP_DIV),
+		VM_LABEL(MEVE_OP_MOD),
+		VM_LABEL(MEVE_OP_CHOOSE),
+		VM_LABEL(MEVE_OP_POW),
+		VM_LABEL(MEVE_OP_MIN),
+		VM_LABEL(MEVE_OP_MAX),
+		VM_LABEL(MEVE_OP_CALL2),
+	};
+#endif
+	num_t buff[MAXLEN_TBUFFER];
+	num_t* vStack = buff;
+	num_t* sp;
+	num_t* temp;
+	const uint8_t* pc;
+	const uint16_t* ap;
+
+	if (!prog || !prog->ops || !res)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	/* Only programs deeper than the local stack allocate. The temporaries
+	 * follow the evaluation stack. */
+	if (prog->depth + prog->tLen > MAXLEN_TBUFFER &&
+		!(vStack = malloc((prog->depth + prog->tLen) * sizeof(num_t))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	sp = vStack;
+	temp = vStack + prog->depth;
+	pc = prog->ops;
+	ap = prog->args;
+
+	/* The program was validated by MeveCompile(), so the operands are
+	 * always on the stack. sp points past the top-of-stack. */
+	VM_DISPATCH
+	{
+		VM_CASE(MEVE_OP_RET)
+		{
+			*res = vStack[0];
+
+			if (vStack != buff)
+			{
+				free(vStack);
+			}
+			return MEVE_ERR_OK;
+		}
+		VM_CASE(MEVE_OP_PUSHK)
+		{
+			*sp++ = prog->kPool[*ap++];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_LOADV)
+		{
+			*sp++ = *prog->vars[*ap++].ptr;
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_LOADT)
+		{
+			*sp++ = temp[*ap++];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_POS)
+		{
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_STORE)
+		{
+			temp[*ap++] = sp[-1];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_NEG)
+		{
+			sp[-1] = -sp[-1];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_EXP)
+		{
+			sp[-1] = MEVE_MATH(exp)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_SQRT)
+		{
+			sp[-1] = MEVE_MATH(sqrt)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_ABS)
+		{
+			sp[-1] = MEVE_MATH(fabs)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_SIN)
+		{
+			sp[-1] = MEVE_MATH(sin)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_COS)
+		{
+			sp[-1] = MEVE_MATH(cos)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_TAN)
+		{
+			sp[-1] = MEVE_MATH(tan)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_ASIN)
+		{
+			sp[-1] = MEVE_MATH(asin)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_ACOS)
+		{
+			sp[-1] = MEVE_MATH(acos)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_ATAN)
+		{
+			sp[-1] = MEVE_MATH(atan)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_LOG10)
+		{
+			sp[-1] = MEVE_MATH(log10)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_LOG)
+		{
+			sp[-1] = MEVE_MATH(log)(sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_FACT)
+		{
+			sp[-1] = Factorial(&sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_CALL1)
+		{
+			sp[-1] = prog->fPool[*ap++](&sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_ADD)
+		{
+			sp--;
+			sp[-1] = sp[-1] + sp[0];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_SUB)
+		{
+			sp--;
+			sp[-1] = sp[-1] - sp[0];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_MUL)
+		{
+			sp--;
+			sp[-1] = sp[-1] * sp[0];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_DIV)
+		{
+			sp--;
+			sp[-1] = sp[-1] / sp[0];
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_MOD)
+		{
+			sp--;
+			sp[-1] = MEVE_MATH(fmod)(sp[-1], sp[0]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_CHOOSE)
+		{
+			sp--;
+			sp[-1] = Choose(&sp[-1]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_POW)
+		{
+			sp--;
+			sp[-1] = MEVE_MATH(pow)(sp[-1], sp[0]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_MIN)
+		{
+			sp--;
+			sp[-1] = MEVE_MATH(fmin)(sp[-1], sp[0]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_MAX)
+		{
+			sp--;
+			sp[-1] = MEVE_MATH(fmax)(sp[-1], sp[0]);
+			VM_NEXT;
+		}
+		VM_CASE(MEVE_OP_CALL2)
+		{
+			sp--;
+			sp[-1] = prog->fPool[*ap++](&sp[-1]);
+			VM_NEXT;
+		}
+#if !defined(__GNUC__) || defined(MEVE_NO_COMPUTED_GOTO)
+		default:
+		{
+			if (vStack != buff)
+			{
+				free(vStack);
+			}
+			return MEVE_ERR_INVALIDEXPR;
+		}
+#endif
+	}
+}
+
+static void BatchBinary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	num_t* restrict a,
+	const num_t* restrict b)
+{
+	num_t arg[2];
+
+	/* The arithmetic is written in the loops so they can be vectorized.
+	 * The trip count is constant so no remainder loop is needed. */
+	switch (op)
+	{
+		case MEVE_OP_ADD:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = a[k] + b[k];
+			}
+			break;
+		}
+		case MEVE_OP_SUB:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = a[k] - b[k];
+			}
+			break;
+		}
+		case MEVE_OP_MUL:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = a[k] * b[k];
+			}
+			break;
+		}
+		case MEVE_OP_DIV:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = a[k] / b[k];
+			}
+			break;
+		}
+		default:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				arg[0] = a[k];
+				arg[1] = b[k];
+				a[k] = fPtr(arg);
+			}
+		}
+	}
+}
+
+static void BatchUnary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	num_t* restrict a)
+{
+	switch (op)
+	{
+		case MEVE_OP_POS:
+		{
+			break;
+		}
+		case MEVE_OP_NEG:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = -a[k];
+			}
+			break;
+		}
+		default:
+		{
+			for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+			{
+				a[k] = fPtr(&a[k]);
+			}
+		}
+	}
+}
+
+MeveCode MeveRunBatch(
+	const MEVE_PROGRAM* prog,
+	const num_t* const* cols,
+	size_t rows,
+	num_t* res)
+{
+	num_t (*blk)[MEVE_BATCH_BLOCK];
+
+	if (!prog || !prog->ops || !res || (prog->varCount && !cols))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	/* The temporaries follow the evaluation stack. */
+	blk = malloc((prog->depth + prog->tLen) * sizeof(*blk));
+
+	if (!blk)
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	for (size_t row = 0; row < rows; row += MEVE_BATCH_BLOCK)
+	{
+		const size_t n = rows - row < MEVE_BATCH_BLOCK ? rows - row : MEVE_BATCH_BLOCK;
+		const uint16_t* ap = prog->args;
+		size_t sp = 0;
+
+		for (const uint8_t* pc = prog->ops; *pc != MEVE_OP_RET; pc++)
+		{
+			const uint16_t arg = MEVE_OP_HAS_ARG(*pc) ? *ap++ : 0;
+			num_t(*fPtr)(const num_t*) = gOpFun[*pc];
+
+			if (*pc == MEVE_OP_CALL1 || *pc == MEVE_OP_CALL2)
+			{
+				fPtr = prog->fPool[arg];
+			}
+
+			switch (MEVE_OP_ARITY(*pc))
+			{
+				case 0:
+				{
+					if (*pc == MEVE_OP_PUSHK)
+					{
+						for (size_t k = 0; k < MEVE_BATCH_BLOCK; k++)
+						{
+							blk[sp][k] = prog->kPool[arg];
+						}
+					}
+					else if (*pc == MEVE_OP_LOADT)
+					{
+						memcpy(blk[sp], blk[prog->depth + arg], sizeof(*blk));
+					}
+					else
+					{
+						/* The rows past the end of a partial block are zeroed,
+						 * so every block is evaluated with the same trip count. */
+						memcpy(blk[sp], &cols[arg][row], n * sizeof(num_t));
+						memset(&blk[sp][n], 0, (MEVE_BATCH_BLOCK - n) * sizeof(num_t));
+					}
+					sp++;
+					break;
+				}
+				case 1:
+				{
+					if (*pc == MEVE_OP_STORE)
+					{
+						memcpy(blk[prog->depth + arg], blk[sp - 1], sizeof(*blk));
+					}
+					else
+					{
+						BatchUnary(*pc, fPtr, blk[sp - 1]);
+					}
+					break;
+				}
+				default:
+				{
+					sp--;
+					BatchBinary(*pc, fPtr, blk[sp - 1], blk[sp]);
+				}
+			}
+		}
+
+		memcpy(&res[row], blk[0], n * sizeof(num_t));
+	}
+
+	free(blk);
+	return MEVE_ERR_OK;
+}
+
+void MeveFree(
+	MEVE_PROGRAM* prog)
+{
+	/* The other pools and streams share the block of the constant pool. */
+	free(prog->kPool);
+	prog->ops = NULL;
+	prog->len = 0;
+	prog->args = NULL;
+	prog->aLen = 0;
+	prog->kPool = NULL;
+	prog->kLen = 0;
+	prog->pLen = 0;
+	prog->fPool = NULL;
+	prog->fLen = 0;
+	prog->depth = 0;
+	prog->tLen = 0;
+	prog->vars = NULL;
+	prog->varCount = 0;
+}
+
+void MeveInit(
+	MEVE_CONTEXT* ctx,
+	MTOKEN* tkBuff,
+	size_t buffSz,
+	const char* iStr)
+{
+	pthread_once(&gKeyTrieOnce, &KeywordsInit);
+	ctx->iStr = iStr;
+	ctx->strLen = strlen(ctx->iStr);
+	ctx->ans = 0;
+	ctx->vars = NULL;
+	ctx->varCount = 0;
+	ctx->arena = NULL;
+	ctx->tkBuff = tkBuff;
+	ctx->buffSz = buffSz;
+	ctx->flags = 0;
+	StackInit(&ctx->expr, tkBuff, buffSz);
+	MeveStatsReset(ctx);
+}
+
+void MeveSetVars(
+	MEVE_CONTEXT* ctx,
+	const MEVE_VAR* vars,
+	size_t varCount)
+{
+	ctx->vars = vars;
+	ctx->varCount = vars ? varCount : 0;
+}
+
+void MeveSetFlags(
+	MEVE_CONTEXT* ctx,
+	uint32_t flags)
+{
+	ctx->flags = flags;
+}
+
+MeveCode MeveCallbackName(
+	num_t(*fPtr)(const num_t*),
+	const char** str,
+	uint8_t* arity)
+{
+	for (size_t i = 0; i < COUNTOF(gFunList); i++)
+	{
+		if (gFunList[i].fPtr == fPtr)
+		{
+			*str = gFunList[i].str;
+			*arity = gFunList[i].arity;
+			return MEVE_ERR_OK;
+		}
+	}
+
+	for (size_t i = 0; i < COUNTOF(gOprList); i++)
+	{
+		if (gOprList[i].fPtr == fPtr)
+		{
+			*str = gOprList[i].str;
+			*arity = gOprList[i].prec == OPR_P_UNARY ? 1 : 2;
+			return MEVE_ERR_OK;
+		}
+	}
+
+	return MEVE_ERR_INVALIDPARAM;
+}
+
+/* Whether two symbols are equal, ignoring the case of their letters. */
+static bool SymbolEqual(
+	const char* a,
+	const char* b)
+{
+	for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++);
+	return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+MeveCode MeveCallbackFind(
+	const char* str,
+	uint8_t arity,
+	num_t(**fPtr)(const num_t*))
+{
+	for (size_t i = 0; i < COUNTOF(gFunList); i++)
+	{
+		if (gFunList[i].arity == arity && SymbolEqual(gFunList[i].str, str))
+		{
+			*fPtr = gFunList[i].fPtr;
+			return MEVE_ERR_OK;
+		}
+	}
+
+	for (size_t i = 0; i < COUNTOF(gOprList); i++)
+	{
+		if ((gOprList[i].prec == OPR_P_UNARY ? 1 : 2) == arity && SymbolEqual(gOprList[i].str, str))
+		{
+			*fPtr = gOprList[i].fPtr;
+			return MEVE_ERR_OK;
+		}
+	}
+
+	return MEVE_ERR_INVALIDPARAM;
+}
+
+MeveCode MeveOpCallback(
+	uint8_t op,
+	num_t(**fPtr)(const num_t*))
+{
+	if (op >= MEVE_OP_COUNT || !gOpFun[op])
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	*fPtr = gOpFun[op];
+	return MEVE_ERR_OK;
+}
+
+void MeveSetArena(
+	MEVE_CONTEXT* ctx,
+	MEVE_ARENA* arena)
+{
+	ctx->arena = arena;
+	StackInit(&ctx->expr, ctx->tkBuff, ctx->buffSz);
+}
+
+void MeveArenaInit(
+	MEVE_ARENA* arena,
+	void* buff,
+	size_t buffSz)
+{
+	const size_t pad = buff ? (size_t)(-(uintptr_t)buff & (ARENA_ALIGN - 1)) : 0;
+
+	arena->buff = buff && buffSz > pad ? (uint8_t*)buff + pad : NULL;
+	arena->buffSz = arena->buff ? buffSz - pad : 0;
+	arena->head = NULL;
+	arena->alloc = NULL;
+	arena->free = NULL;
+	arena->user = NULL;
+	MeveArenaReset(arena);
+}
+
+void MeveArenaReset(
+	MEVE_ARENA* arena)
+{
+	arena->cur = NULL;
+	arena->ptr = arena->buff;
+	arena->left = arena->buffSz;
+}
+
+void MeveArenaFree(
+	MEVE_ARENA* arena)
+{
+	while (arena->head)
+	{
+		MEVE_ARENA_BLOCK* next = arena->head->next;
+
+		if (arena->free)
+		{
+			arena->free(arena->user, arena->head);
+		}
+		else
+		{
+			free(arena->head);
+		}
+		arena->head = next;
+	}
+
+	MeveArenaReset(arena);
+}
 
 void MeveUpdate(
 	MEVE_CONTEXT* ctx)
 {
+	if (ctx->arena)
+	{
+		MeveArenaReset(ctx->arena);
+		StackInit(&ctx->expr, ctx->tkBuff, ctx->buffSz);
+	}
+
 	StackClear(&ctx->expr);
 	ctx->strLen = strlen(ctx->iStr);
-}
\ No newline at end of file
+}
+
+MeveCode MeveStatsSnapshot(
+	const MEVE_CONTEXT* ctx,
+	MEVE_STATS* stats)
+{
+	if (!stats)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+#ifdef MEVE_USE_STATS
+	if (ctx)
+	{
+		*stats = ctx->stats;
+		return MEVE_ERR_OK;
+	}
+#endif
+
+	memset(stats, 0, sizeof(MEVE_STATS));
+	return MEVE_ERR_INVALIDPARAM;
+}
+
+void MeveStatsReset(
+	MEVE_CONTEXT* ctx)
+{
+#ifdef MEVE_USE_STATS
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+#else
+	(void)ctx;
+#endif
+}
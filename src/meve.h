@@ -17,6 +17,9 @@
 /* Maximum size of the temporary buffer, in bytes.	*/
 #define MAXSIZE_TBUFFER		(MAXLEN_TBUFFER * sizeof(MTOKEN))
 
+/* Number of rows evaluated together by MeveRunBatch().	*/
+#define MEVE_BATCH_BLOCK	64
+
 /* Token types.							*/
 typedef enum MeveTokenType
 {
@@ -27,8 +30,54 @@ typedef enum MeveTokenType
 	MEVE_TT_OPR,				/* Operator.							*/
 	MEVE_TT_FUN,				/* Function.							*/
 	MEVE_TT_CONST,				/* Constant.							*/
+	MEVE_TT_VAR,				/* Variable.							*/
+	MEVE_TT_PARAM,				/* Number literal bound at run time.	*/
 }MeveTokenType;
 
+/* Bytecode operation codes.			*/
+typedef enum MeveOpCode
+{
+	MEVE_OP_RET,				/* Returns the top-of-stack.			*/
+	MEVE_OP_PUSHK,				/* Pushes a constant.					*/
+	MEVE_OP_LOADV,				/* Pushes a variable.					*/
+	MEVE_OP_LOADT,				/* Pushes a temporary.					*/
+	MEVE_OP_POS,				/* Unary plus.							*/
+	MEVE_OP_STORE,				/* Copies the top-of-stack to a temporary.	*/
+	MEVE_OP_NEG,				/* Unary minus.							*/
+	MEVE_OP_EXP,				/* Exponential.							*/
+	MEVE_OP_SQRT,				/* Square root.							*/
+	MEVE_OP_ABS,				/* Absolute value.						*/
+	MEVE_OP_SIN,				/* Sine.								*/
+	MEVE_OP_COS,				/* Cosine.								*/
+	MEVE_OP_TAN,				/* Tangent.								*/
+	MEVE_OP_ASIN,				/* Arc sine.							*/
+	MEVE_OP_ACOS,				/* Arc cosine.							*/
+	MEVE_OP_ATAN,				/* Arc tangent.							*/
+	MEVE_OP_LOG10,				/* Common logarithm.					*/
+	MEVE_OP_LOG,				/* Natural logarithm.					*/
+	MEVE_OP_FACT,				/* Factorial.							*/
+	MEVE_OP_CALL1,				/* Calls a callback of arity 1.			*/
+	MEVE_OP_ADD,				/* Addition.							*/
+	MEVE_OP_SUB,				/* Subtraction.							*/
+	MEVE_OP_MUL,				/* Multiplication.						*/
+	MEVE_OP_DIV,				/* Division.							*/
+	MEVE_OP_MOD,				/* Floating-point remainder.			*/
+	MEVE_OP_CHOOSE,				/* Combination.							*/
+	MEVE_OP_POW,				/* Power.								*/
+	MEVE_OP_MIN,				/* Smallest of two values.				*/
+	MEVE_OP_MAX,				/* Largest of two values.				*/
+	MEVE_OP_CALL2,				/* Calls a callback of arity 2.			*/
+	MEVE_OP_COUNT				/* Number of operation codes.			*/
+}MeveOpCode;
+
+/* Number of operands taken by an operation code.	*/
+#define MEVE_OP_ARITY(op)	((op) < MEVE_OP_POS ? 0 : (op) < MEVE_OP_ADD ? 1 : 2)
+
+/* Whether an operation code reads an index from the operand stream.	*/
+#define MEVE_OP_HAS_ARG(op)	((op) == MEVE_OP_PUSHK || (op) == MEVE_OP_LOADV || \
+	(op) == MEVE_OP_LOADT || (op) == MEVE_OP_STORE || \
+	(op) == MEVE_OP_CALL1 || (op) == MEVE_OP_CALL2)
+
 /* Operator structure.					*/
 typedef struct MEVE_OPR
 {
@@ -36,6 +85,7 @@ typedef struct MEVE_OPR
 	num_t(*fPtr)(const num_t*);	/* Callback function pointer.			*/
 	int8_t prec;				/* Operator precedence.					*/
 	int8_t as;					/* Operator associativity.				*/
+	uint8_t op;					/* Bytecode operation code.				*/
 }MEVE_OPR;
 
 /* Function structure.					*/
@@ -45,6 +95,7 @@ typedef struct MEVE_FUN
 	num_t(*fPtr)(const num_t*);	/* Operator callback function pointer.	*/
 	uint8_t arity;				/* Function arity.						*/
 	int8_t as;					/* Function associativity.				*/
+	uint8_t op;					/* Bytecode operation code.				*/
 }MEVE_FUN;
 
 /* Constant structure.					*/
@@ -54,6 +105,13 @@ typedef struct MEVE_CONST
 	num_t cVal;					/* The value of the constant.			*/
 }MEVE_CONST;
 
+/* Variable structure.					*/
+typedef struct MEVE_VAR
+{
+	const char* str;			/* Pointer to a null-terminated string.	*/
+	const num_t* ptr;			/* Pointer to the caller-owned value.	*/
+}MEVE_VAR;
+
 /* Token data.							*/
 typedef union MTOKEN_EVAL
 {
@@ -61,6 +119,8 @@ typedef union MTOKEN_EVAL
 	const MEVE_OPR* opr;		/* Pointer to an operator structure.	*/
 	const MEVE_FUN* fun;		/* Pointer to a function structure.		*/
 	const MEVE_CONST* cst;		/* Pointer to a constant structure.		*/
+	const MEVE_VAR* var;		/* Pointer to a variable structure.		*/
+	size_t param;				/* Index of a parameter.				*/
 }MTOKEN_EVAL;
 
 /* Token structure.						*/
@@ -79,6 +139,84 @@ typedef struct TSTACK
 	MTOKEN* top;				/* Pointer to the top-of-stack.			*/
 }TSTACK;
 
+/* Compiled program.
+ *
+ * The constant pool, the callback pool, the operand stream and the
+ * operation codes share one allocation, in that order. Each operation code
+ * takes one byte and the ones matched by MEVE_OP_HAS_ARG() consume the
+ * next 16-bit index of the operand stream.
+ * A subexpression used more than once is evaluated once: MEVE_OP_STORE
+ * copies its value to a temporary slot, which MEVE_OP_LOADT pushes again
+ * where the subexpression is repeated. The slots live after the depth
+ * entries of the evaluation stack.
+*/
+typedef struct MEVE_PROGRAM
+{
+	uint8_t* ops;				/* Operation codes, ended by MEVE_OP_RET.	*/
+	size_t len;					/* Number of operation codes.			*/
+	uint16_t* args;				/* Pointer to the operand stream.		*/
+	size_t aLen;				/* Number of operands.					*/
+	num_t* kPool;				/* Pointer to the constant pool.		*/
+	size_t kLen;				/* Number of constants.					*/
+	size_t pLen;				/* Number of parameters in kPool.		*/
+	num_t(**fPool)(const num_t*);	/* Pointer to the callback pool.	*/
+	size_t fLen;				/* Number of callbacks.					*/
+	size_t depth;				/* Maximum evaluation stack depth.		*/
+	size_t tLen;				/* Number of temporary slots.			*/
+	const MEVE_VAR* vars;		/* Variable table used to compile.		*/
+	size_t varCount;			/* Number of variables in the table.	*/
+}MEVE_PROGRAM;
+
+/* Block of memory allocated by an arena.	*/
+typedef struct MEVE_ARENA_BLOCK
+{
+	struct MEVE_ARENA_BLOCK* next;	/* Pointer to the next block.		*/
+	size_t sz;					/* Size of the block data, in bytes.	*/
+}MEVE_ARENA_BLOCK;
+
+/* Bump allocator.						*/
+typedef struct MEVE_ARENA
+{
+	uint8_t* buff;				/* Caller-supplied first block, or NULL.	*/
+	size_t buffSz;				/* Size of the first block, in bytes.	*/
+	MEVE_ARENA_BLOCK* head;		/* Pointer to the allocated blocks.		*/
+	MEVE_ARENA_BLOCK* cur;		/* Block in use, or NULL for buff.		*/
+	uint8_t* ptr;				/* Pointer to the free memory.			*/
+	size_t left;				/* Free bytes in the block in use.		*/
+	void* (*alloc)(void*, size_t);	/* Allocates a block, or NULL.		*/
+	void (*free)(void*, void*);	/* Releases a block, or NULL.			*/
+	void* user;					/* First argument of alloc and free.	*/
+}MEVE_ARENA;
+
+/* Stages timed by the instrumentation.	*/
+typedef enum MeveStage
+{
+	MEVE_STAGE_TOKENS,			/* CreateTokens().						*/
+	MEVE_STAGE_POSTFIX,			/* InfixToPostfix().					*/
+	MEVE_STAGE_PARSE,			/* CreatePostfix().						*/
+	MEVE_STAGE_OPTIMIZE,		/* PostfixOptimize().					*/
+	MEVE_STAGE_EVAL,			/* PostfixEval().						*/
+	MEVE_STAGE_COUNT			/* Number of stages.					*/
+}MeveStage;
+
+/* Instrumentation counters.			*/
+typedef struct MEVE_STATS
+{
+	uint64_t ticks[MEVE_STAGE_COUNT];	/* Time spent in each stage.	*/
+	uint64_t runs[MEVE_STAGE_COUNT];	/* Calls of each stage.			*/
+	uint64_t tokens;			/* Tokens read from input-strings.		*/
+	uint64_t implicitMuls;		/* Implicit multiplications inserted.	*/
+	uint64_t evalTokens;		/* Postfix tokens evaluated.			*/
+	uint64_t maxDepth;			/* Deepest operand stack.				*/
+	uint64_t calls[MEVE_OP_COUNT];	/* Evaluations of each operation code.	*/
+}MEVE_STATS;
+
+/* Compiler flags.						*/
+typedef enum MeveFlag
+{
+	MEVE_FLAG_FASTMATH = 1,		/* Rewrites not exact in IEEE 754.		*/
+}MeveFlag;
+
 /* Meve context.						*/
 typedef struct MEVE_CONTEXT
 {
@@ -86,6 +224,15 @@ typedef struct MEVE_CONTEXT
 	size_t strLen;				/* Input-string length.					*/
 	TSTACK expr;				/* Stack used to store the tokens.		*/
 	num_t ans;					/* Most recent answer.					*/
+	const MEVE_VAR* vars;		/* Pointer to the variable table.		*/
+	size_t varCount;			/* Number of variables in the table.	*/
+	MEVE_ARENA* arena;			/* Pointer to the arena, or NULL.		*/
+	MTOKEN* tkBuff;				/* Pointer to the caller token buffer.	*/
+	size_t buffSz;				/* Size of the caller token buffer.		*/
+	uint32_t flags;				/* MeveFlag values of the compiler.		*/
+#ifdef MEVE_USE_STATS
+	MEVE_STATS stats;			/* Instrumentation counters.			*/
+#endif
 }MEVE_CONTEXT;
 
 /* Error messages.						*/
@@ -97,6 +244,7 @@ typedef enum MeveErrorMessage
 	MEVE_ERR_OUTOFSTACK,		/* Out of stack.						*/
 	MEVE_ERR_PARESNOTBALANCED,	/* Parentheses not balanced.			*/
 	MEVE_ERR_INVALIDEXPR,		/* Invalid expression.					*/
+	MEVE_ERR_OUTOFMEMORY,		/* Out of memory.						*/
 }MeveCode;
 
 /* Create tokens by reading an input string.
@@ -122,12 +270,40 @@ MeveCode CreateTokens(
 MeveCode InfixToPostfix(
 	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
 
+/* Creates the postfix expression of an input string in a single pass.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Equivalent to checking the brackets and calling CreateTokens() and
+ * InfixToPostfix(), but each token is fed to the operator stack as soon
+ * as it is read, and the brackets are checked from that stack. The input
+ * is read once and ctx->expr only receives the postfix expression.
+*/
+MeveCode CreatePostfix(
+	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
+
+/* Optimizes a postfix expression.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * This function must be called after InfixToPostfix() or CreatePostfix().
+ * Subexpressions made only of numbers and constants are folded into a
+ * single number, and unary plus, multiplication or division by one and
+ * subtraction of zero are removed. The result of the evaluation is not
+ * changed. Expressions that are not valid are left for PostfixEval()
+ * to report.
+*/
+MeveCode PostfixOptimize(
+	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
+
 /* Evaluates a postfix expression.
  *
  * If the function succeeds, the return value is MEVE_ERR_OK.
  *
  * Remarks:
- * This function must be called after InfixToPostfix().
+ * This function must be called after InfixToPostfix() or PostfixOptimize().
  * The stack ctx->expr must be a valid postfix expression.
 */
 MeveCode PostfixEval(
@@ -143,6 +319,84 @@ MeveCode PostfixEval(
 MeveCode EvalString(
 	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
 
+/* Compiles an expression in a string into a self-contained program.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The ctx pointer cannot be null. The stack ctx->expr is used as scratch
+ * storage and its content is undefined after the call.
+ * The program does not reference the context and must be released by
+ * calling MeveFree(). Variables are bound to the entries of ctx->vars, so
+ * the table and the values it points to must outlive the program.
+ * Subexpressions repeated in the input-string are evaluated once when they
+ * only involve built-in operators and functions; the entries added to the
+ * tables may have side effects, so each of their calls is kept.
+ * Divisions by a power of two are turned into multiplications by its
+ * reciprocal, which give the same results. Other rewrites are made under
+ * the flags of MeveSetFlags().
+*/
+MeveCode MeveCompile(
+	MEVE_CONTEXT* ctx,			/* Pointer to a MEVE_CONTEXT structure.	*/
+	MEVE_PROGRAM* prog);		/* Pointer to the program to be filled.	*/
+
+/* Compiles the tokens of an expression into a program whose number
+ * literals are parameters.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * This function must be called after CreateTokens(). It works like
+ * MeveCompile(), except that the number literals are neither folded nor
+ * simplified: prog->kPool[i] holds the i-th number literal of the input-
+ * string, for i below prog->pLen. The program can evaluate any expression
+ * whose tokens differ only in their number literals, once these literals
+ * are copied to the parameters. Native programs copy the constant pool
+ * when they are compiled, so they do not see the parameters change.
+*/
+MeveCode MeveCompileParams(
+	MEVE_CONTEXT* ctx,			/* Pointer to a MEVE_CONTEXT structure.	*/
+	MEVE_PROGRAM* prog);		/* Pointer to the program to be filled.	*/
+
+/* Evaluates a compiled program.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The program is not modified, so it can be evaluated any number of times.
+ * The built-in operators and functions are executed inline; only entries
+ * with MEVE_OP_CALL1 or MEVE_OP_CALL2 go through their callback.
+ * Dispatch uses computed goto with GCC and Clang, unless
+ * MEVE_NO_COMPUTED_GOTO is defined, and a switch otherwise.
+*/
+MeveCode MeveRun(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	num_t* res);				/* Receives the result.					*/
+
+/* Evaluates a compiled program over a batch of rows.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The inputs are given in columns: cols[i] points to the rows values of
+ * the variable prog->vars[i], so cols must have prog->varCount entries.
+ * Each token is executed once for a block of MEVE_BATCH_BLOCK rows, which
+ * keeps the dispatch out of the inner loops.
+*/
+MeveCode MeveRunBatch(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	const num_t* const* cols,	/* Pointer to the input columns.		*/
+	size_t rows,				/* Number of rows.						*/
+	num_t* res);				/* Receives one result per row.			*/
+
+/* Releases the resources of a compiled program.
+ *
+ * Remarks:
+ * The prog pointer cannot be null. Releasing an empty program is allowed.
+*/
+void MeveFree(
+	MEVE_PROGRAM* prog);		/* Pointer to a compiled program.		*/
+
 /* Initializes a Meve context.
  *
  * Remarks:
@@ -154,12 +408,159 @@ void MeveInit(
 	size_t buffSz,				/* Buffer size.							*/
 	const char* iStr);			/* Pointer to the input-string.			*/
 
+/* Sets the variable table of a Meve context.
+ *
+ * Remarks:
+ * Identifiers are resolved against the table while the tokens are created,
+ * so changing the values pointed by the entries does not require the
+ * expression to be parsed again. Names are case insensitive and must be
+ * made of letters, digits and underscores, not starting with a digit.
+ * A variable takes precedence over a built-in with the same name.
+*/
+void MeveSetVars(
+	MEVE_CONTEXT* ctx,			/* Pointer to a Meve context.			*/
+	const MEVE_VAR* vars,		/* Pointer to the variable table.		*/
+	size_t varCount);			/* Number of variables in the table.	*/
+
+/* Sets the compiler flags of a Meve context.
+ *
+ * Remarks:
+ * The flags are a combination of MeveFlag values, and are 0 after
+ * MeveInit(), so the programs give the results of the evaluation of the
+ * postfix expression. With MEVE_FLAG_FASTMATH, MeveCompile() and
+ * MeveCompileParams() rewrite x^0.5 as sqrt(x), x^n with an integer n up
+ * to 16 in magnitude as products of repeated squares, of 1/x for a
+ * negative n, and divisions by a constant as multiplications by its
+ * rounded reciprocal. The results may then differ in the last bits, in
+ * more of them when a negative power is subnormal, and for x^0.5 in the
+ * sign of a zero and at -inf.
+ * Programs compiled before the call are not changed. The parameters of
+ * MeveCompileParams() are never rewritten, since they are not constants.
+*/
+void MeveSetFlags(
+	MEVE_CONTEXT* ctx,			/* Pointer to a Meve context.			*/
+	uint32_t flags);			/* Combination of MeveFlag values.		*/
+
+/* Retrieves the stable identifier of a callback of the tables.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * A callback is identified by the symbol of its operator or function and
+ * by its arity, which together select one entry of the tables, so the
+ * identifier does not change when the engine is built again. *str is not
+ * to be released. MEVE_ERR_INVALIDPARAM is returned when no entry has
+ * fPtr as its callback.
+*/
+MeveCode MeveCallbackName(
+	num_t(*fPtr)(const num_t*),	/* Callback of an operator or function.	*/
+	const char** str,			/* Receives the symbol of the entry.	*/
+	uint8_t* arity);			/* Receives the arity of the entry.		*/
+
+/* Retrieves the callback of a stable identifier.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * This is the reverse of MeveCallbackName(). The symbol is case
+ * insensitive. MEVE_ERR_INVALIDPARAM is returned when no entry matches.
+*/
+MeveCode MeveCallbackFind(
+	const char* str,			/* Symbol of an operator or function.	*/
+	uint8_t arity,				/* Arity of the entry.					*/
+	num_t(**fPtr)(const num_t*));	/* Receives the callback.			*/
+
+/* Retrieves the callback of a built-in operation code.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * This is the function the interpreters call for op, so the other
+ * evaluators give the same results bit for bit. MEVE_ERR_INVALIDPARAM is
+ * returned for the operation codes without one, such as MEVE_OP_PUSHK or
+ * MEVE_OP_CALL1, whose callback is in the pool of the program.
+*/
+MeveCode MeveOpCallback(
+	uint8_t op,					/* Operation code.						*/
+	num_t(**fPtr)(const num_t*));	/* Receives the callback.			*/
+
+/* Sets the arena of a Meve context.
+ *
+ * Remarks:
+ * Without an arena the tokens are limited to the buffer given to
+ * MeveInit() and the conversion and evaluation stacks to MAXLEN_TBUFFER
+ * entries, and MEVE_ERR_OUTOFSTACK is returned beyond that. With an arena
+ * these storages grow on demand from the arena. MeveUpdate() resets the
+ * arena, so an arena cannot be shared by two contexts.
+ * Passing NULL goes back to the fixed buffers.
+*/
+void MeveSetArena(
+	MEVE_CONTEXT* ctx,			/* Pointer to a Meve context.			*/
+	MEVE_ARENA* arena);			/* Pointer to an arena, or NULL.		*/
+
+/* Initializes an arena.
+ *
+ * Remarks:
+ * The arena pointer cannot be null. The first allocations are taken from
+ * buff, which can be NULL. Further blocks, each at least twice as large
+ * as the previous one, are obtained from arena->alloc, or from malloc()
+ * when it is NULL; both alloc and free can be set after this call.
+*/
+void MeveArenaInit(
+	MEVE_ARENA* arena,			/* Pointer to an arena.					*/
+	void* buff,					/* Pointer to the first block, or NULL.	*/
+	size_t buffSz);				/* Size of the first block, in bytes.	*/
+
+/* Releases every allocation of an arena at once.
+ *
+ * Remarks:
+ * The blocks are kept to be reused, so resetting is O(1).
+*/
+void MeveArenaReset(
+	MEVE_ARENA* arena);			/* Pointer to an arena.					*/
+
+/* Releases the blocks allocated by an arena.
+ *
+ * Remarks:
+ * The caller-supplied block is not released.
+*/
+void MeveArenaFree(
+	MEVE_ARENA* arena);			/* Pointer to an arena.					*/
+
 /* Updates Meve context entries.
  *
  * Remarks:
  * This function should be call every time the input-string changes.
  * The ctx pointer cannot be null and must be properly initialized. 
+ * The arena of the context, if any, is reset.
 */
 void MeveUpdate(
 	MEVE_CONTEXT* ctx);			/* Pointer to a Meve context.			*/
+
+/* Retrieves the instrumentation counters of a Meve context.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The counters are only kept when the engine and every unit including
+ * meve.h are built with MEVE_USE_STATS; otherwise stats is zeroed and
+ * MEVE_ERR_INVALIDPARAM is returned. The ticks are TSC cycles on x86 and
+ * nanoseconds elsewhere. Only the functions taking a context are counted:
+ * MeveRun() and the native code have no context to update. The calls,
+ * made while evaluating or while folding constants, are indexed by
+ * operation code, so the entries added to the tables are all
+ * counted under MEVE_OP_CALL1 or MEVE_OP_CALL2.
+*/
+MeveCode MeveStatsSnapshot(
+	const MEVE_CONTEXT* ctx,	/* Pointer to a Meve context.			*/
+	MEVE_STATS* stats);			/* Receives the counters.				*/
+
+/* Resets the instrumentation counters of a Meve context.
+ *
+ * Remarks:
+ * The ctx pointer cannot be null. MeveInit() also resets the counters,
+ * but MeveUpdate() does not.
+*/
+void MeveStatsReset(
+	MEVE_CONTEXT* ctx);			/* Pointer to a Meve context.			*/
 #endif
\ No newline at end of file
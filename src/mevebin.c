@@ -0,0 +1,498 @@
+#include "mevebin.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define IMAGE_MAGIC				"MEVE"	/* First bytes of an image.		*/
+#define IMAGE_ORDER				UINT32_C(0x01020304)	/* Byte order mark.	*/
+
+#define IMAGE_ALIGNUP(n)		(((n) + MEVE_IMAGE_ALIGN - 1) & ~(uint64_t)(MEVE_IMAGE_ALIGN - 1))
+
+/* Header at the start of an image. Every offset is counted from the
+ * start of the image.	*/
+typedef struct IMAGE_HEADER
+{
+	char magic[4];				/* IMAGE_MAGIC, not null-terminated.	*/
+	uint16_t version;			/* MEVE_IMAGE_VERSION.					*/
+	uint8_t numSize;			/* Size of num_t, in bytes.				*/
+	uint8_t numDigits;			/* Mantissa bits of num_t.				*/
+	uint32_t order;				/* IMAGE_ORDER in the writer byte order.	*/
+	uint32_t count;				/* Number of programs.					*/
+	uint32_t varCount;			/* Number of variable names.			*/
+	uint32_t fLen;				/* Number of callback identifiers.		*/
+	uint64_t size;				/* Size of the image, in bytes.			*/
+	uint64_t dirOff;			/* Offset of the program entries.		*/
+	uint64_t varOff;			/* Offset of the variable names.		*/
+	uint64_t funOff;			/* Offset of the callback identifiers.	*/
+}IMAGE_HEADER;
+
+/* Name of a variable or identifier of a callback.	*/
+typedef struct IMAGE_NAME
+{
+	uint32_t off;				/* Offset of the null-terminated name.	*/
+	uint32_t arity;				/* Arity of a callback, or 0.			*/
+}IMAGE_NAME;
+
+/* Program entry of an image.			*/
+typedef struct IMAGE_ENTRY
+{
+	uint64_t kOff;				/* Offset of the constant pool.			*/
+	uint64_t aOff;				/* Offset of the operand stream.		*/
+	uint64_t oOff;				/* Offset of the operation codes.		*/
+	uint32_t kLen;				/* Number of constants.					*/
+	uint32_t pLen;				/* Number of parameters in the pool.	*/
+	uint32_t aLen;				/* Number of operands.					*/
+	uint32_t len;				/* Number of operation codes.			*/
+	uint32_t depth;				/* Maximum evaluation stack depth.		*/
+	uint32_t tLen;				/* Number of temporary slots.			*/
+}IMAGE_ENTRY;
+
+/* Whether two names are equal, ignoring the case of their letters. */
+static bool ImageNameEqual(
+	const char* a,
+	const char* b)
+{
+	for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); a++, b++);
+	return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+/* Whether the n bytes at off lie in an image of sz bytes. */
+static bool ImageInside(
+	const uint64_t sz,
+	const uint64_t off,
+	const uint64_t n)
+{
+	return off <= sz && n <= sz - off;
+}
+
+/* Returns the name at off, or NULL when it does not end in the image. */
+static const char* ImageString(
+	const MEVE_IMAGE* img,
+	const uint32_t off)
+{
+	const char* str = (const char*)&img->data[off];
+
+	return off < img->sz && memchr(str, 0, img->sz - off) ? str : NULL;
+}
+
+/* Returns the index of a callback in the identifiers, adding it if new. */
+static size_t ImageCallback(
+	num_t(**fPool)(const num_t*),
+	size_t* fLen,
+	num_t(*fPtr)(const num_t*))
+{
+	for (size_t i = 0; i < *fLen; i++)
+	{
+		if (fPool[i] == fPtr)
+		{
+			return i;
+		}
+	}
+
+	fPool[*fLen] = fPtr;
+	return (*fLen)++;
+}
+
+MeveCode MeveImageWrite(
+	const MEVE_PROGRAM* const* progs,
+	size_t count,
+	void* buff,
+	size_t* sz)
+{
+	const MEVE_PROGRAM* vp = NULL;
+	num_t(**fPool)(const num_t*) = NULL;
+	size_t fCap = 0;
+	size_t fLen = 0;
+	uint64_t off;
+	uint64_t strOff;
+	uint8_t* out = buff;
+	IMAGE_HEADER* hdr;
+	IMAGE_ENTRY* dir;
+	IMAGE_NAME* names;
+	MeveCode res = MEVE_ERR_OK;
+
+	if ((!progs && count) || !sz || count > UINT32_MAX || ((uintptr_t)buff & (MEVE_IMAGE_ALIGN - 1)))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	/* The programs with variables share one table, whose names are
+	 * stored once. */
+	for (size_t i = 0; i < count; i++)
+	{
+		const MEVE_PROGRAM* prog = progs[i];
+
+		if (!prog || !prog->ops || prog->len > UINT32_MAX)
+		{
+			return MEVE_ERR_INVALIDPARAM;
+		}
+
+		if (prog->varCount)
+		{
+			if (!vp)
+			{
+				vp = prog;
+			}
+			else if (prog->vars != vp->vars || prog->varCount != vp->varCount)
+			{
+				return MEVE_ERR_INVALIDPARAM;
+			}
+		}
+		fCap += prog->fLen;
+	}
+
+	/* The identifiers are read through 16-bit operands. */
+	if (fCap > UINT16_MAX)
+	{
+		return MEVE_ERR_INVALIDSIZE;
+	}
+
+	if (fCap && !(fPool = malloc(fCap * sizeof(*fPool))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t k = 0; k < progs[i]->fLen; k++)
+		{
+			ImageCallback(fPool, &fLen, progs[i]->fPool[k]);
+		}
+	}
+
+	/* The header, the entries and the names come first, then the pools
+	 * and streams of each program, starting on an aligned offset. */
+	off = sizeof(IMAGE_HEADER) + count * sizeof(IMAGE_ENTRY) +
+		((vp ? vp->varCount : 0) + fLen) * sizeof(IMAGE_NAME);
+	strOff = off;
+
+	for (size_t i = 0; vp && i < vp->varCount; i++)
+	{
+		off += strlen(vp->vars[i].str) + 1;
+	}
+
+	for (size_t i = 0; i < fLen; i++)
+	{
+		const char* str;
+		uint8_t arity;
+
+		if ((res = MeveCallbackName(fPool[i], &str, &arity)) != MEVE_ERR_OK)
+		{
+			free(fPool);
+			return res;
+		}
+		off += strlen(str) + 1;
+	}
+
+	off = IMAGE_ALIGNUP(off);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const MEVE_PROGRAM* prog = progs[i];
+
+		off = IMAGE_ALIGNUP(off + prog->kLen * sizeof(num_t) + prog->aLen * sizeof(uint16_t) + prog->len + 1);
+	}
+
+	if (!buff || *sz < off)
+	{
+		*sz = (size_t)off;
+		free(fPool);
+		return buff ? MEVE_ERR_INVALIDSIZE : MEVE_ERR_OK;
+	}
+
+	*sz = (size_t)off;
+	memset(out, 0, *sz);
+	hdr = (IMAGE_HEADER*)out;
+	dir = (IMAGE_ENTRY*)&out[sizeof(IMAGE_HEADER)];
+	names = (IMAGE_NAME*)&dir[count];
+
+	memcpy(hdr->magic, IMAGE_MAGIC, sizeof(hdr->magic));
+	hdr->version = MEVE_IMAGE_VERSION;
+	hdr->numSize = sizeof(num_t);
+	hdr->numDigits = MEVE_NUM_MANT_DIG;
+	hdr->order = IMAGE_ORDER;
+	hdr->count = (uint32_t)count;
+	hdr->varCount = vp ? (uint32_t)vp->varCount : 0;
+	hdr->fLen = (uint32_t)fLen;
+	hdr->size = off;
+	hdr->dirOff = sizeof(IMAGE_HEADER);
+	hdr->varOff = hdr->dirOff + count * sizeof(IMAGE_ENTRY);
+	hdr->funOff = hdr->varOff + hdr->varCount * sizeof(IMAGE_NAME);
+
+	off = strOff;
+
+	for (size_t i = 0; i < hdr->varCount + fLen; i++)
+	{
+		const char* str;
+		uint8_t arity = 0;
+
+		if (i < hdr->varCount)
+		{
+			str = vp->vars[i].str;
+		}
+		else
+		{
+			MeveCallbackName(fPool[i - hdr->varCount], &str, &arity);
+		}
+
+		names[i].off = (uint32_t)off;
+		names[i].arity = arity;
+		memcpy(&out[off], str, strlen(str) + 1);
+		off += strlen(str) + 1;
+	}
+
+	off = IMAGE_ALIGNUP(off);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const MEVE_PROGRAM* prog = progs[i];
+		const uint16_t* ap = prog->args;
+		num_t* kPool;
+		uint16_t* args;
+
+		dir[i].kOff = off;
+		dir[i].aOff = dir[i].kOff + prog->kLen * sizeof(num_t);
+		dir[i].oOff = dir[i].aOff + prog->aLen * sizeof(uint16_t);
+		dir[i].kLen = (uint32_t)prog->kLen;
+		dir[i].pLen = (uint32_t)prog->pLen;
+		dir[i].aLen = (uint32_t)prog->aLen;
+		dir[i].len = (uint32_t)prog->len;
+		dir[i].depth = (uint32_t)prog->depth;
+		dir[i].tLen = (uint32_t)prog->tLen;
+		kPool = (num_t*)&out[dir[i].kOff];
+		args = (uint16_t*)&out[dir[i].aOff];
+
+		/* The values are assigned, so the padding of num_t stays zero. */
+		for (size_t k = 0; k < prog->kLen; k++)
+		{
+			kPool[k] = prog->kPool[k];
+		}
+
+		/* The callbacks are renumbered into the identifiers of the image. */
+		for (size_t k = 0; k < prog->len; k++)
+		{
+			const uint8_t op = prog->ops[k];
+
+			if (MEVE_OP_HAS_ARG(op))
+			{
+				*args++ = op == MEVE_OP_CALL1 || op == MEVE_OP_CALL2 ?
+					(uint16_t)ImageCallback(fPool, &fLen, prog->fPool[*ap]) : *ap;
+				ap++;
+			}
+		}
+
+		memcpy(&out[dir[i].oOff], prog->ops, prog->len);
+		out[dir[i].oOff + prog->len] = MEVE_OP_RET;
+		off = IMAGE_ALIGNUP(dir[i].oOff + prog->len + 1);
+	}
+
+	free(fPool);
+	return MEVE_ERR_OK;
+}
+
+MeveCode MeveImageOpen(
+	MEVE_IMAGE* img,
+	const void* data,
+	size_t sz,
+	const MEVE_VAR* vars,
+	size_t varCount)
+{
+	const IMAGE_HEADER* hdr = data;
+	const IMAGE_NAME* names;
+
+	if (!img || !data || ((uintptr_t)data & (MEVE_IMAGE_ALIGN - 1)))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	/* A failed image is empty, so it can be released as well. */
+	img->data = NULL;
+	img->sz = 0;
+	img->count = 0;
+	img->fPool = NULL;
+	img->fLen = 0;
+
+	if (sz < sizeof(IMAGE_HEADER) || memcmp(hdr->magic, IMAGE_MAGIC, sizeof(hdr->magic)) ||
+		hdr->version != MEVE_IMAGE_VERSION || hdr->numSize != sizeof(num_t) ||
+		hdr->numDigits != MEVE_NUM_MANT_DIG || hdr->order != IMAGE_ORDER || hdr->size > sz ||
+		hdr->dirOff % sizeof(uint64_t) || hdr->varOff % sizeof(uint32_t) || hdr->funOff % sizeof(uint32_t) ||
+		!ImageInside(hdr->size, hdr->dirOff, (uint64_t)hdr->count * sizeof(IMAGE_ENTRY)) ||
+		!ImageInside(hdr->size, hdr->varOff, (uint64_t)hdr->varCount * sizeof(IMAGE_NAME)) ||
+		!ImageInside(hdr->size, hdr->funOff, (uint64_t)hdr->fLen * sizeof(IMAGE_NAME)))
+	{
+		return MEVE_ERR_INVALIDEXPR;
+	}
+
+	if (hdr->varCount > varCount || (hdr->varCount && !vars))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	img->data = data;
+	img->sz = (size_t)hdr->size;
+	img->vars = vars;
+	img->varCount = hdr->varCount;
+
+	/* The programs read the variables by their index in the table. */
+	names = (const IMAGE_NAME*)&img->data[hdr->varOff];
+
+	for (size_t i = 0; i < hdr->varCount; i++)
+	{
+		const char* str = ImageString(img, names[i].off);
+
+		if (!str)
+		{
+			return MEVE_ERR_INVALIDEXPR;
+		}
+
+		if (!ImageNameEqual(str, vars[i].str))
+		{
+			return MEVE_ERR_INVALIDPARAM;
+		}
+	}
+
+	if (hdr->fLen && !(img->fPool = malloc(hdr->fLen * sizeof(*img->fPool))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	names = (const IMAGE_NAME*)&img->data[hdr->funOff];
+
+	for (size_t i = 0; i < hdr->fLen; i++)
+	{
+		const char* str = ImageString(img, names[i].off);
+
+		if (!str || names[i].arity > UINT8_MAX ||
+			MeveCallbackFind(str, (uint8_t)names[i].arity, &img->fPool[i]) != MEVE_ERR_OK)
+		{
+			MeveImageClose(img);
+			return MEVE_ERR_INVALIDEXPR;
+		}
+	}
+
+	img->count = hdr->count;
+	img->fLen = hdr->fLen;
+	return MEVE_ERR_OK;
+}
+
+MeveCode MeveImageProgram(
+	const MEVE_IMAGE* img,
+	size_t index,
+	MEVE_PROGRAM* prog)
+{
+	const IMAGE_HEADER* hdr;
+	const IMAGE_ENTRY* e;
+	const IMAGE_NAME* funs;
+	const uint8_t* ops;
+	const uint16_t* args;
+	size_t sp = 0;
+	size_t ap = 0;
+
+	if (!img || !img->data || !prog || index >= img->count)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	hdr = (const IMAGE_HEADER*)img->data;
+	funs = (const IMAGE_NAME*)&img->data[hdr->funOff];
+	e = &((const IMAGE_ENTRY*)&img->data[hdr->dirOff])[index];
+
+	/* Each entry of the stack is pushed and each slot stored by its own
+	 * operation code. */
+	if (e->kOff % MEVE_IMAGE_ALIGN || e->aOff % sizeof(uint16_t) || !e->len || e->pLen > e->kLen ||
+		e->depth > e->len || e->tLen > e->len ||
+		!ImageInside(img->sz, e->kOff, (uint64_t)e->kLen * sizeof(num_t)) ||
+		!ImageInside(img->sz, e->aOff, (uint64_t)e->aLen * sizeof(uint16_t)) ||
+		!ImageInside(img->sz, e->oOff, (uint64_t)e->len + 1))
+	{
+		return MEVE_ERR_INVALIDEXPR;
+	}
+
+	ops = &img->data[e->oOff];
+	args = (const uint16_t*)&img->data[e->aOff];
+
+	/* Every operand index must select an entry of its pool, and the stack
+	 * must stay within the depth the evaluators allocate. */
+	for (size_t i = 0; i < e->len; i++)
+	{
+		const uint8_t op = ops[i];
+		const size_t arity = MEVE_OP_ARITY(op);
+
+		if (op == MEVE_OP_RET || op >= MEVE_OP_COUNT || sp < arity)
+		{
+			return MEVE_ERR_INVALIDEXPR;
+		}
+
+		if (MEVE_OP_HAS_ARG(op))
+		{
+			const uint16_t arg = ap < e->aLen ? args[ap++] : UINT16_MAX;
+			size_t lim;
+
+			switch (op)
+			{
+				case MEVE_OP_PUSHK:
+				{
+					lim = e->kLen;
+					break;
+				}
+				case MEVE_OP_LOADV:
+				{
+					lim = img->varCount;
+					break;
+				}
+				case MEVE_OP_LOADT:
+				case MEVE_OP_STORE:
+				{
+					lim = e->tLen;
+					break;
+				}
+				default:
+				{
+					lim = arg < img->fLen && funs[arg].arity == arity ? img->fLen : 0;
+					break;
+				}
+			}
+
+			if (arg >= lim)
+			{
+				return MEVE_ERR_INVALIDEXPR;
+			}
+		}
+
+		if ((sp = sp + 1 - arity) > e->depth)
+		{
+			return MEVE_ERR_INVALIDEXPR;
+		}
+	}
+
+	if (sp != 1 || ap != e->aLen || ops[e->len] != MEVE_OP_RET)
+	{
+		return MEVE_ERR_INVALIDEXPR;
+	}
+
+	prog->ops = (uint8_t*)ops;
+	prog->len = e->len;
+	prog->args = (uint16_t*)args;
+	prog->aLen = e->aLen;
+	prog->kPool = (num_t*)&img->data[e->kOff];
+	prog->kLen = e->kLen;
+	prog->pLen = e->pLen;
+	prog->fPool = img->fPool;
+	prog->fLen = img->fLen;
+	prog->depth = e->depth;
+	prog->tLen = e->tLen;
+	prog->vars = img->vars;
+	prog->varCount = img->varCount;
+	return MEVE_ERR_OK;
+}
+
+void MeveImageClose(
+	MEVE_IMAGE* img)
+{
+	free(img->fPool);
+	img->data = NULL;
+	img->sz = 0;
+	img->count = 0;
+	img->fPool = NULL;
+	img->fLen = 0;
+}
\ No newline at end of file
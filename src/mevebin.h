@@ -0,0 +1,105 @@
+#ifndef MEVEBIN_H
+#define MEVEBIN_H
+#include "meve.h"
+
+/* Binary images of compiled programs.
+ *
+ * An image holds any number of programs in one block of bytes that only
+ * refers to itself through offsets, so it can be written to a file and
+ * mapped read-only with mmap() at any address. The programs of an opened
+ * image point into the block: nothing is parsed or copied before they
+ * are run.
+ * The callbacks of the tables are stored by their stable identifiers (see
+ * MeveCallbackName()) and the variables by their names, and both are
+ * resolved when the image is opened. The numbers are stored in the format
+ * of num_t and the integers in the byte order of the machine, so an image
+ * can only be opened by a build of the same precision on a machine with
+ * the same byte order; MeveImageOpen() checks both.
+*/
+
+/* Version of the image format.			*/
+#define MEVE_IMAGE_VERSION	1
+
+/* Alignment of the start of an image.	*/
+#define MEVE_IMAGE_ALIGN	16
+
+/* Opened image.						*/
+typedef struct MEVE_IMAGE
+{
+	const uint8_t* data;		/* Pointer to the image bytes.			*/
+	size_t sz;					/* Size of the image, in bytes.			*/
+	size_t count;				/* Number of programs.					*/
+	const MEVE_VAR* vars;		/* Variable table of the programs.		*/
+	size_t varCount;			/* Number of variables of the programs.	*/
+	num_t(**fPool)(const num_t*);	/* Callbacks of the identifiers.	*/
+	size_t fLen;				/* Number of callbacks.					*/
+}MEVE_IMAGE;
+
+/* Writes compiled programs to an image.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The programs using variables must have been compiled with the same
+ * variable table, whose names are stored in the image. *sz is the size of
+ * buff and receives the size of the image; when buff is NULL or too small
+ * nothing is written, and MEVE_ERR_INVALIDSIZE is returned in the latter
+ * case. buff must be aligned to MEVE_IMAGE_ALIGN.
+ * MEVE_ERR_INVALIDPARAM is returned when a callback has no identifier.
+*/
+MeveCode MeveImageWrite(
+	const MEVE_PROGRAM* const* progs,	/* Pointer to the programs.		*/
+	size_t count,				/* Number of programs.					*/
+	void* buff,					/* Receives the image, or NULL.			*/
+	size_t* sz);				/* Size of buff, receives the image size.	*/
+
+/* Opens an image of compiled programs.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * data must be aligned to MEVE_IMAGE_ALIGN, which holds for the addresses
+ * returned by mmap(), and must outlive the image, which must be released
+ * by calling MeveImageClose(), even when this function fails. The
+ * variable names of the image must be the first entries of vars, in the
+ * same order; the programs are bound to these entries.
+ * MEVE_ERR_INVALIDEXPR is returned when the image has another version,
+ * precision or byte order, when it is truncated, or when an identifier
+ * matches no entry of the tables of this build.
+ * Only the header and the identifiers are read here, so opening does not
+ * depend on the number of programs.
+*/
+MeveCode MeveImageOpen(
+	MEVE_IMAGE* img,			/* Pointer to the image to be filled.	*/
+	const void* data,			/* Pointer to the image bytes.			*/
+	size_t sz,					/* Size of the image, in bytes.			*/
+	const MEVE_VAR* vars,		/* Pointer to the variable table.		*/
+	size_t varCount);			/* Number of variables in the table.	*/
+
+/* Retrieves a program of an opened image.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The pools and streams of prog point into the image and its callbacks
+ * into img->fPool, so the program is valid while the image is open and
+ * must not be released with MeveFree(). The operation codes are checked
+ * in one pass, without allocating, so that a damaged image cannot make
+ * the program read outside of its pools; MEVE_ERR_INVALIDEXPR is returned
+ * otherwise. The parameters of a program of MeveCompileParams() keep the
+ * values they had when the image was written, and cannot be bound again
+ * in a read-only mapping.
+*/
+MeveCode MeveImageProgram(
+	const MEVE_IMAGE* img,		/* Pointer to an opened image.			*/
+	size_t index,				/* Index of the program in the image.	*/
+	MEVE_PROGRAM* prog);		/* Pointer to the program to be filled.	*/
+
+/* Releases the resources of an opened image.
+ *
+ * Remarks:
+ * The img pointer cannot be null. The image bytes are not released.
+*/
+void MeveImageClose(
+	MEVE_IMAGE* img);			/* Pointer to an opened image.			*/
+#endif
\ No newline at end of file
@@ -0,0 +1,481 @@
+#include "mevecache.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define FNV_OFFSET				UINT64_C(14695981039346656037)
+#define FNV_PRIME				UINT64_C(1099511628211)
+
+#define CACHE_KEY_TEXT			't'	/* Key of an input-string.			*/
+#define CACHE_KEY_SHAPE			's'	/* Key of a token shape.			*/
+
+/* Cached program.						*/
+typedef struct CACHE_ENTRY
+{
+	struct CACHE_ENTRY* next;	/* Next entry of the bucket.			*/
+	struct CACHE_ENTRY* newer;	/* Next more recently used entry.		*/
+	struct CACHE_ENTRY* older;	/* Next less recently used entry.		*/
+	uint64_t hash;				/* Hash of the key.						*/
+	uint8_t* key;				/* Key bytes.							*/
+	size_t keyLen;				/* Key length.							*/
+	MEVE_PROGRAM prog;			/* Compiled program.					*/
+}CACHE_ENTRY;
+
+struct MEVE_CACHE
+{
+	CACHE_ENTRY** buckets;		/* Hash buckets.						*/
+	size_t mask;				/* Number of buckets minus one.			*/
+	CACHE_ENTRY* newest;		/* Most recently used entry.			*/
+	CACHE_ENTRY* oldest;		/* Least recently used entry.			*/
+	uint8_t* key;				/* Key being looked up.					*/
+	size_t keyLen;				/* Length of the key being looked up.	*/
+	size_t keySz;				/* Size of the key buffer.				*/
+	MEVE_CACHE_STATS stats;		/* Counters.							*/
+};
+
+static bool KeyReserve(
+	MEVE_CACHE* cache,
+	const size_t len)
+{
+	if (cache->keyLen + len > cache->keySz)
+	{
+		size_t sz = cache->keySz ? cache->keySz : 256;
+		uint8_t* key;
+
+		while (sz < cache->keyLen + len)
+		{
+			sz *= 2;
+		}
+
+		if (!(key = realloc(cache->key, sz)))
+		{
+			return false;
+		}
+
+		cache->key = key;
+		cache->keySz = sz;
+	}
+	return true;
+}
+
+static bool KeyAppend(
+	MEVE_CACHE* cache,
+	const void* bytes,
+	const size_t len)
+{
+	if (!KeyReserve(cache, len))
+	{
+		return false;
+	}
+
+	memcpy(&cache->key[cache->keyLen], bytes, len);
+	cache->keyLen += len;
+	return true;
+}
+
+/* Starts a key with its kind, the variable table of the context, since
+ * programs are bound to the table they were compiled with, and the flags
+ * they were compiled under. */
+static bool KeyBegin(
+	MEVE_CACHE* cache,
+	const MEVE_CONTEXT* ctx,
+	const uint8_t kind)
+{
+	cache->keyLen = 0;
+
+	return KeyAppend(cache, &kind, sizeof(kind)) &&
+		KeyAppend(cache, &ctx->vars, sizeof(ctx->vars)) &&
+		KeyAppend(cache, &ctx->varCount, sizeof(ctx->varCount)) &&
+		KeyAppend(cache, &ctx->flags, sizeof(ctx->flags));
+}
+
+/* Appends the input-string with its letters folded to lowercase, runs of
+ * whitespace folded to one space and the outer whitespace removed. */
+static bool KeyText(
+	MEVE_CACHE* cache,
+	const MEVE_CONTEXT* ctx)
+{
+	const char* str = ctx->iStr;
+	const char* end = ctx->iStr + ctx->strLen;
+	bool space = false;
+
+	if (!KeyReserve(cache, ctx->strLen))
+	{
+		return false;
+	}
+
+	for (; str != end; str++)
+	{
+		if (isspace((unsigned char)*str))
+		{
+			space = true;
+			continue;
+		}
+
+		if (space && cache->keyLen > 1 + sizeof(ctx->vars) + sizeof(ctx->varCount) + sizeof(ctx->flags))
+		{
+			cache->key[cache->keyLen++] = ' ';
+		}
+
+		space = false;
+		cache->key[cache->keyLen++] = (uint8_t)tolower((unsigned char)*str);
+	}
+	return true;
+}
+
+/* Appends the type of every token and the entry it refers to. Number
+ * literals only add their type. */
+static bool KeyShape(
+	MEVE_CACHE* cache,
+	const MEVE_CONTEXT* ctx)
+{
+	const size_t tkSz = 1 + sizeof(const void*);
+
+	if (!KeyReserve(cache, ctx->expr.len * tkSz))
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < ctx->expr.len; i++)
+	{
+		const MTOKEN* tk = &ctx->expr.tk[i];
+		const void* id = NULL;
+
+		cache->key[cache->keyLen++] = (uint8_t)tk->type;
+
+		switch (tk->type)
+		{
+			case MEVE_TT_OPR:
+			{
+				id = tk->data.opr;
+				break;
+			}
+			case MEVE_TT_FUN:
+			{
+				id = tk->data.fun;
+				break;
+			}
+			case MEVE_TT_CONST:
+			{
+				id = tk->data.cst;
+				break;
+			}
+			case MEVE_TT_VAR:
+			{
+				id = tk->data.var;
+				break;
+			}
+			default:
+			{
+				continue;
+			}
+		}
+
+		memcpy(&cache->key[cache->keyLen], &id, sizeof(id));
+		cache->keyLen += sizeof(id);
+	}
+	return true;
+}
+
+static uint64_t KeyHash(
+	const MEVE_CACHE* cache)
+{
+	uint64_t hash = FNV_OFFSET;
+
+	for (size_t i = 0; i < cache->keyLen; i++)
+	{
+		hash = (hash ^ cache->key[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+static void CacheUnlink(
+	MEVE_CACHE* cache,
+	CACHE_ENTRY* entry)
+{
+	if (entry->newer)
+	{
+		entry->newer->older = entry->older;
+	}
+	else
+	{
+		cache->newest = entry->older;
+	}
+
+	if (entry->older)
+	{
+		entry->older->newer = entry->newer;
+	}
+	else
+	{
+		cache->oldest = entry->newer;
+	}
+}
+
+static void CachePushNewest(
+	MEVE_CACHE* cache,
+	CACHE_ENTRY* entry)
+{
+	entry->newer = NULL;
+	entry->older = cache->newest;
+
+	if (cache->newest)
+	{
+		cache->newest->newer = entry;
+	}
+	else
+	{
+		cache->oldest = entry;
+	}
+	cache->newest = entry;
+}
+
+static void CacheRemove(
+	MEVE_CACHE* cache,
+	CACHE_ENTRY* entry)
+{
+	CACHE_ENTRY** link = &cache->buckets[entry->hash & cache->mask];
+
+	while (*link != entry)
+	{
+		link = &(*link)->next;
+	}
+
+	*link = entry->next;
+	CacheUnlink(cache, entry);
+	MeveFree(&entry->prog);
+	free(entry->key);
+	free(entry);
+	cache->stats.count--;
+}
+
+/* Looks the key being built up, counting the hit or the miss. */
+static CACHE_ENTRY* CacheFind(
+	MEVE_CACHE* cache,
+	const uint64_t hash)
+{
+	CACHE_ENTRY* entry;
+
+	for (entry = cache->buckets[hash & cache->mask]; entry; entry = entry->next)
+	{
+		if (entry->hash == hash && entry->keyLen == cache->keyLen &&
+			!memcmp(entry->key, cache->key, cache->keyLen))
+		{
+			cache->stats.hits++;
+
+			if (entry != cache->newest)
+			{
+				CacheUnlink(cache, entry);
+				CachePushNewest(cache, entry);
+			}
+			return entry;
+		}
+	}
+
+	cache->stats.misses++;
+	return NULL;
+}
+
+/* Takes a compiled program under the key being built up, evicting the
+ * least recently used entry when the cache is full. */
+static bool CacheInsert(
+	MEVE_CACHE* cache,
+	const uint64_t hash,
+	const MEVE_PROGRAM* prog)
+{
+	CACHE_ENTRY* entry = malloc(sizeof(CACHE_ENTRY));
+
+	if (!entry || !(entry->key = malloc(cache->keyLen)))
+	{
+		free(entry);
+		return false;
+	}
+
+	memcpy(entry->key, cache->key, cache->keyLen);
+	entry->keyLen = cache->keyLen;
+	entry->hash = hash;
+	entry->prog = *prog;
+
+	if (cache->stats.count == cache->stats.capacity)
+	{
+		CacheRemove(cache, cache->oldest);
+		cache->stats.evictions++;
+	}
+
+	entry->next = cache->buckets[hash & cache->mask];
+	cache->buckets[hash & cache->mask] = entry;
+	CachePushNewest(cache, entry);
+	cache->stats.count++;
+
+	return true;
+}
+
+MeveCode MeveCacheCreate(
+	MEVE_CACHE** cache,
+	size_t capacity)
+{
+	MEVE_CACHE* c;
+	size_t buckets = 1;
+
+	if (!cache || !capacity)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	*cache = NULL;
+
+	/* At most one entry per bucket on average. */
+	while (buckets < capacity)
+	{
+		buckets <<= 1;
+	}
+
+	if (!(c = calloc(1, sizeof(MEVE_CACHE))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	if (!(c->buckets = calloc(buckets, sizeof(CACHE_ENTRY*))))
+	{
+		free(c);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	c->mask = buckets - 1;
+	c->stats.capacity = capacity;
+	*cache = c;
+
+	return MEVE_ERR_OK;
+}
+
+MeveCode MeveCacheEval(
+	MEVE_CACHE* cache,
+	MEVE_CONTEXT* ctx)
+{
+	CACHE_ENTRY* entry;
+	MEVE_PROGRAM prog;
+	MeveCode res;
+	uint64_t hash;
+
+	if (!cache || !ctx || !ctx->iStr || !ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	if (!KeyBegin(cache, ctx, CACHE_KEY_TEXT) || !KeyText(cache, ctx))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	hash = KeyHash(cache);
+
+	if ((entry = CacheFind(cache, hash)))
+	{
+		return MeveRun(&entry->prog, &ctx->ans);
+	}
+
+	/* Nothing is evicted for an input-string that does not compile. */
+	if ((res = MeveCompile(ctx, &prog)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	if (!CacheInsert(cache, hash, &prog))
+	{
+		MeveFree(&prog);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	return MeveRun(&cache->newest->prog, &ctx->ans);
+}
+
+MeveCode MeveCacheEvalShape(
+	MEVE_CACHE* cache,
+	MEVE_CONTEXT* ctx)
+{
+	CACHE_ENTRY* entry;
+	MEVE_PROGRAM prog;
+	MeveCode res;
+	uint64_t hash;
+
+	if (!cache || !ctx || !ctx->iStr || !ctx->strLen)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	if ((res = CreateTokens(ctx)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	if (!KeyBegin(cache, ctx, CACHE_KEY_SHAPE) || !KeyShape(cache, ctx))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	hash = KeyHash(cache);
+
+	if ((entry = CacheFind(cache, hash)))
+	{
+		size_t param = 0;
+
+		/* Only programs that compiled are cached, so the tokens are a
+		 * valid expression and only the literals have to be bound. */
+		for (size_t i = 0; i < ctx->expr.len; i++)
+		{
+			if (ctx->expr.tk[i].type == MEVE_TT_NUM)
+			{
+				entry->prog.kPool[param++] = ctx->expr.tk[i].data.val;
+			}
+		}
+		return MeveRun(&entry->prog, &ctx->ans);
+	}
+
+	/* Nothing is evicted for an input-string that does not compile. */
+	if ((res = MeveCompileParams(ctx, &prog)) != MEVE_ERR_OK)
+	{
+		return res;
+	}
+
+	if (!CacheInsert(cache, hash, &prog))
+	{
+		MeveFree(&prog);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	return MeveRun(&cache->newest->prog, &ctx->ans);
+}
+
+void MeveCacheStats(
+	const MEVE_CACHE* cache,
+	MEVE_CACHE_STATS* stats)
+{
+	*stats = cache->stats;
+}
+
+void MeveCacheClear(
+	MEVE_CACHE* cache)
+{
+	while (cache->oldest)
+	{
+		CacheRemove(cache, cache->oldest);
+	}
+
+	cache->stats.hits = 0;
+	cache->stats.misses = 0;
+	cache->stats.evictions = 0;
+}
+
+void MeveCacheFree(
+	MEVE_CACHE* cache)
+{
+	if (!cache)
+	{
+		return;
+	}
+
+	MeveCacheClear(cache);
+	free(cache->buckets);
+	free(cache->key);
+	free(cache);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef MEVECACHE_H
+#define MEVECACHE_H
+#include "meve.h"
+
+/* Cache of compiled expressions.
+ *
+ * Programs are keyed either by the input-string, with its letters folded
+ * to lowercase, runs of whitespace folded to one space and the leading
+ * and trailing whitespace removed, or by the shape of its tokens, which
+ * leaves out the values of the number literals. Both keys include the
+ * variable table of the context. When the cache is full the least
+ * recently used program is released.
+ *
+ * A cache is not thread-safe. It can be shared by any number of contexts
+ * used by the same thread.
+*/
+
+/* Cache counters.						*/
+typedef struct MEVE_CACHE_STATS
+{
+	uint64_t hits;				/* Lookups that found a program.		*/
+	uint64_t misses;			/* Lookups that compiled a program.		*/
+	uint64_t evictions;			/* Programs released to make room.		*/
+	size_t count;				/* Programs held by the cache.			*/
+	size_t capacity;			/* Maximum number of programs.			*/
+}MEVE_CACHE_STATS;
+
+/* Compiled expression cache.			*/
+typedef struct MEVE_CACHE MEVE_CACHE;
+
+/* Creates a compiled expression cache.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The cache must be released by calling MeveCacheFree().
+*/
+MeveCode MeveCacheCreate(
+	MEVE_CACHE** cache,			/* Receives the pointer to the cache.	*/
+	size_t capacity);			/* Maximum number of programs.			*/
+
+/* Evaluates an expression in a string through a cache.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Works like EvalString(). When the string is in the cache its program
+ * is run directly, without checking the brackets, creating the tokens or
+ * converting them to postfix. Otherwise the string is compiled with
+ * MeveCompile() and its program is added to the cache. Strings that fail
+ * to compile are not cached.
+*/
+MeveCode MeveCacheEval(
+	MEVE_CACHE* cache,			/* Pointer to a cache.					*/
+	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
+
+/* Evaluates an expression in a string through a cache of token shapes.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Works like MeveCacheEval(), but the tokens are always created and the
+ * program is looked up by their shape, so expressions that differ only in
+ * their number literals share a program compiled with MeveCompileParams().
+ * On a hit the literals are bound to the parameters of the program, and
+ * the conversion to postfix is skipped.
+ * As with EvalString(), MeveUpdate() must be called when the input-string
+ * changes.
+*/
+MeveCode MeveCacheEvalShape(
+	MEVE_CACHE* cache,			/* Pointer to a cache.					*/
+	MEVE_CONTEXT* ctx);			/* Pointer to a MEVE_CONTEXT structure.	*/
+
+/* Retrieves the counters of a cache.
+ *
+ * Remarks:
+ * Both cache and stats pointers cannot be null.
+*/
+void MeveCacheStats(
+	const MEVE_CACHE* cache,	/* Pointer to a cache.					*/
+	MEVE_CACHE_STATS* stats);	/* Receives the counters.				*/
+
+/* Releases every program of a cache and resets its counters.
+ *
+ * Remarks:
+ * The cache pointer cannot be null.
+*/
+void MeveCacheClear(
+	MEVE_CACHE* cache);			/* Pointer to a cache.					*/
+
+/* Releases the resources of a cache.
+ *
+ * Remarks:
+ * Releasing a null cache is allowed.
+*/
+void MeveCacheFree(
+	MEVE_CACHE* cache);			/* Pointer to a cache.					*/
+#endif
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "mevediff.h"
+#include "mevemath.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define DIFF_LN10				2.302585092994045684017991454684364208L	/* ln(10).	*/
+
+/* Multiplies the derivatives of a by f.
+ *
+ * Zero derivatives are kept, so a constant operand stays constant where
+ * f is not finite. */
+static void DualScale(
+	num_t* a,
+	const size_t n,
+	const num_t f)
+{
+	for (size_t i = 1; i <= n; i++)
+	{
+		if (a[i] != 0)
+		{
+			a[i] *= f;
+		}
+	}
+}
+
+/* Sets the derivatives of a to fa * a' + fb * b'. */
+static void DualCombine(
+	num_t* a,
+	const num_t* b,
+	const size_t n,
+	const num_t fa,
+	const num_t fb)
+{
+	for (size_t i = 1; i <= n; i++)
+	{
+		a[i] = (a[i] != 0 ? fa * a[i] : 0) + (b[i] != 0 ? fb * b[i] : 0);
+	}
+}
+
+/* Derivative of a callback with respect to its argument i, by central
+ * differences. */
+static num_t DiffSlope(
+	num_t(*fPtr)(const num_t*),
+	const num_t* x,
+	const size_t arity,
+	const size_t i)
+{
+	num_t hi[2];
+	num_t lo[2];
+	const num_t h = MEVE_MATH(cbrt)(MEVE_NUM_EPSILON) * MEVE_MATH(fmax)(1, MEVE_MATH(fabs)(x[i]));
+
+	for (size_t k = 0; k < arity; k++)
+	{
+		hi[k] = lo[k] = x[k];
+	}
+
+	hi[i] += h;
+	lo[i] -= h;
+
+	return (fPtr(hi) - fPtr(lo)) / (hi[i] - lo[i]);
+}
+
+static void DiffUnary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	num_t* a,
+	const size_t n)
+{
+	const num_t x = a[0];
+	num_t val;
+	num_t f;
+
+	switch (op)
+	{
+		case MEVE_OP_POS:
+		{
+			return;
+		}
+		case MEVE_OP_NEG:
+		{
+			val = -x;
+			f = -1;
+			break;
+		}
+		case MEVE_OP_EXP:
+		{
+			val = MEVE_MATH(exp)(x);
+			f = val;
+			break;
+		}
+		case MEVE_OP_SQRT:
+		{
+			val = MEVE_MATH(sqrt)(x);
+			f = (num_t)0.5 / val;
+			break;
+		}
+		case MEVE_OP_ABS:
+		{
+			val = MEVE_MATH(fabs)(x);
+			f = (num_t)((x > 0) - (x < 0));
+			break;
+		}
+		case MEVE_OP_SIN:
+		{
+			val = MEVE_MATH(sin)(x);
+			f = MEVE_MATH(cos)(x);
+			break;
+		}
+		case MEVE_OP_COS:
+		{
+			val = MEVE_MATH(cos)(x);
+			f = -MEVE_MATH(sin)(x);
+			break;
+		}
+		case MEVE_OP_TAN:
+		{
+			val = MEVE_MATH(tan)(x);
+			f = 1 + val * val;
+			break;
+		}
+		case MEVE_OP_ASIN:
+		{
+			val = MEVE_MATH(asin)(x);
+			f = 1 / MEVE_MATH(sqrt)(1 - x * x);
+			break;
+		}
+		case MEVE_OP_ACOS:
+		{
+			val = MEVE_MATH(acos)(x);
+			f = -1 / MEVE_MATH(sqrt)(1 - x * x);
+			break;
+		}
+		case MEVE_OP_ATAN:
+		{
+			val = MEVE_MATH(atan)(x);
+			f = 1 / (1 + x * x);
+			break;
+		}
+		case MEVE_OP_LOG10:
+		{
+			val = MEVE_MATH(log10)(x);
+			f = 1 / (x * (num_t)DIFF_LN10);
+			break;
+		}
+		case MEVE_OP_LOG:
+		{
+			val = MEVE_MATH(log)(x);
+			f = 1 / x;
+			break;
+		}
+		case MEVE_OP_FACT:
+		{
+			/* (x!)' = Gamma(x + 1) * psi(x + 1); negative arguments are
+			 * constant at 0. */
+			const num_t x1 = x + 1;
+
+			val = Factorial(&x);
+			f = val != 0 ? val * Digamma(&x1) : 0;
+			break;
+		}
+		default:
+		{
+			val = fPtr(&x);
+			f = DiffSlope(fPtr, &x, 1, 0);
+		}
+	}
+
+	DualScale(a, n, f);
+	a[0] = val;
+}
+
+static void DiffBinary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	num_t* a,
+	const num_t* b,
+	const size_t n)
+{
+	const num_t arg[2] = { a[0], b[0] };
+	num_t val;
+	num_t fa;
+	num_t fb;
+
+	switch (op)
+	{
+		case MEVE_OP_ADD:
+		{
+			val = arg[0] + arg[1];
+			fa = 1;
+			fb = 1;
+			break;
+		}
+		case MEVE_OP_SUB:
+		{
+			val = arg[0] - arg[1];
+			fa = 1;
+			fb = -1;
+			break;
+		}
+		case MEVE_OP_MUL:
+		{
+			val = arg[0] * arg[1];
+			fa = arg[1];
+			fb = arg[0];
+			break;
+		}
+		case MEVE_OP_DIV:
+		{
+			val = arg[0] / arg[1];
+			fa = 1 / arg[1];
+			fb = -val / arg[1];
+			break;
+		}
+		case MEVE_OP_MOD:
+		{
+			/* fmod(x, y) = x - trunc(x / y) * y. */
+			val = MEVE_MATH(fmod)(arg[0], arg[1]);
+			fa = 1;
+			fb = -MEVE_MATH(trunc)(arg[0] / arg[1]);
+			break;
+		}
+		case MEVE_OP_CHOOSE:
+		{
+			/* C(n, k) = Gamma(n + 1) / (Gamma(k + 1) * Gamma(n - k + 1)). */
+			const num_t n1 = arg[0] + 1;
+			const num_t k1 = arg[1] + 1;
+			const num_t nk1 = arg[0] - arg[1] + 1;
+
+			val = Choose(arg);
+			fa = fb = 0;
+
+			if (val != 0)
+			{
+				fa = val * (Digamma(&n1) - Digamma(&nk1));
+				fb = val * (Digamma(&nk1) - Digamma(&k1));
+			}
+			break;
+		}
+		case MEVE_OP_POW:
+		{
+			val = MEVE_MATH(pow)(arg[0], arg[1]);
+			fa = arg[1] * MEVE_MATH(pow)(arg[0], arg[1] - 1);
+			fb = val * MEVE_MATH(log)(arg[0]);
+			break;
+		}
+		case MEVE_OP_MIN:
+		{
+			/* The derivative of the operand fmin() returns. */
+			val = MEVE_MATH(fmin)(arg[0], arg[1]);
+			fa = arg[0] <= arg[1] || isnan(arg[1]);
+			fb = 1 - fa;
+			break;
+		}
+		case MEVE_OP_MAX:
+		{
+			val = MEVE_MATH(fmax)(arg[0], arg[1]);
+			fa = arg[0] >= arg[1] || isnan(arg[1]);
+			fb = 1 - fa;
+			break;
+		}
+		default:
+		{
+			val = fPtr(arg);
+			fa = DiffSlope(fPtr, arg, 2, 0);
+			fb = DiffSlope(fPtr, arg, 2, 1);
+		}
+	}
+
+	DualCombine(a, b, n, fa, fb);
+	a[0] = val;
+}
+
+MeveCode MeveRunGrad(
+	const MEVE_PROGRAM* prog,
+	const size_t* wrt,
+	size_t wrtCount,
+	num_t* res,
+	num_t* grad)
+{
+	num_t buff[MAXLEN_TBUFFER];
+	num_t* stack = buff;
+	const uint16_t* ap;
+	size_t width;
+	size_t sp = 0;
+
+	if (!wrt && prog)
+	{
+		wrtCount = prog->varCount;
+	}
+
+	if (!prog || !prog->ops || !res || (wrtCount && !grad))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	for (size_t i = 0; wrt && i < wrtCount; i++)
+	{
+		if (wrt[i] >= prog->varCount)
+		{
+			return MEVE_ERR_INVALIDPARAM;
+		}
+	}
+
+	/* Each entry holds its value followed by its derivatives. The
+	 * temporaries follow the evaluation stack. */
+	width = wrtCount + 1;
+
+	if ((prog->depth + prog->tLen) * width > MAXLEN_TBUFFER &&
+		!(stack = malloc((prog->depth + prog->tLen) * width * sizeof(num_t))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	ap = prog->args;
+
+	for (const uint8_t* pc = prog->ops; *pc != MEVE_OP_RET; pc++)
+	{
+		const uint16_t arg = MEVE_OP_HAS_ARG(*pc) ? *ap++ : 0;
+		num_t(*fPtr)(const num_t*) = NULL;
+
+		if (*pc == MEVE_OP_CALL1 || *pc == MEVE_OP_CALL2)
+		{
+			fPtr = prog->fPool[arg];
+		}
+
+		switch (MEVE_OP_ARITY(*pc))
+		{
+			case 0:
+			{
+				num_t* top = &stack[sp * width];
+
+				sp++;
+
+				if (*pc == MEVE_OP_LOADT)
+				{
+					memcpy(top, &stack[(prog->depth + arg) * width], width * sizeof(num_t));
+					break;
+				}
+
+				for (size_t i = 1; i < width; i++)
+				{
+					top[i] = 0;
+				}
+
+				if (*pc == MEVE_OP_PUSHK)
+				{
+					top[0] = prog->kPool[arg];
+				}
+				else
+				{
+					/* Seeds the variable's own direction. */
+					top[0] = *prog->vars[arg].ptr;
+
+					for (size_t i = 0; i < wrtCount; i++)
+					{
+						top[i + 1] = (wrt ? wrt[i] : i) == arg;
+					}
+				}
+				break;
+			}
+			case 1:
+			{
+				if (*pc == MEVE_OP_STORE)
+				{
+					memcpy(&stack[(prog->depth + arg) * width], &stack[(sp - 1) * width], width * sizeof(num_t));
+				}
+				else
+				{
+					DiffUnary(*pc, fPtr, &stack[(sp - 1) * width], wrtCount);
+				}
+				break;
+			}
+			default:
+			{
+				sp--;
+				DiffBinary(*pc, fPtr, &stack[(sp - 1) * width], &stack[sp * width], wrtCount);
+			}
+		}
+	}
+
+	*res = stack[0];
+
+	for (size_t i = 0; i < wrtCount; i++)
+	{
+		grad[i] = stack[i + 1];
+	}
+
+	if (stack != buff)
+	{
+		free(stack);
+	}
+	return MEVE_ERR_OK;
+}
\ No newline at end of file
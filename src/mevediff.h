@@ -0,0 +1,28 @@
+#ifndef MEVEDIFF_H
+#define MEVEDIFF_H
+#include "meve.h"
+
+/* Evaluates a compiled program and its gradient.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The program is evaluated once with dual numbers: every stack entry
+ * carries its value and its partial derivatives with respect to the
+ * variables prog->vars[wrt[i]], for i below wrtCount, and grad[i]
+ * receives the derivative with respect to prog->vars[wrt[i]]. When wrt
+ * is NULL the derivatives are taken with respect to every variable of the
+ * table and grad must have prog->varCount entries.
+ * The built-in operators and functions are differentiated exactly. The
+ * entries with MEVE_OP_CALL1 or MEVE_OP_CALL2 have no known derivative
+ * and are differentiated by central differences. Where a function is not
+ * differentiable, such as abs(x) at 0, a one-sided derivative or 0 is
+ * returned, and a derivative that only multiplies a zero derivative is 0.
+*/
+MeveCode MeveRunGrad(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	const size_t* wrt,			/* Indices of the variables, or NULL.	*/
+	size_t wrtCount,			/* Number of indices in wrt.			*/
+	num_t* res,					/* Receives the result.					*/
+	num_t* grad);				/* Receives one derivative per variable.	*/
+#endif
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "meveincr.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define INCR_NONE				UINT32_MAX	/* Missing operand of an entry.	*/
+#define INCR_WORDBITS			64	/* Entries per word of the dirty set.	*/
+
+/* Whether two values cannot be told apart by the entries reading them. */
+static bool IncrSame(
+	const num_t a,
+	const num_t b)
+{
+	return (a == b && signbit(a) == signbit(b)) || (isnan(a) && isnan(b));
+}
+
+/* Index of the lowest set bit of a non-zero word. */
+static size_t IncrLowBit(
+	uint64_t w)
+{
+#ifdef __GNUC__
+	return (size_t)__builtin_ctzll(w);
+#else
+	size_t i = 0;
+
+	while (!(w & 1))
+	{
+		w >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+static void IncrMark(
+	MEVE_INCR* inc,
+	const uint32_t i,
+	size_t* first)
+{
+	const size_t w = i / INCR_WORDBITS;
+
+	inc->dirty[w] |= UINT64_C(1) << (i % INCR_WORDBITS);
+
+	if (w < *first)
+	{
+		*first = w;
+	}
+}
+
+/* Evaluates the entry i from the values of its operands. */
+static num_t IncrEval(
+	const MEVE_INCR* inc,
+	const uint32_t i)
+{
+	const MEVE_PROGRAM* prog = inc->prog;
+	const uint8_t op = prog->ops[i];
+	const uint32_t* child = &inc->child[2 * i];
+	num_t(*fPtr)(const num_t*);
+	num_t arg[2];
+
+	switch (op)
+	{
+		case MEVE_OP_PUSHK:
+		{
+			return prog->kPool[inc->arg[i]];
+		}
+		case MEVE_OP_LOADV:
+		{
+			return inc->last[inc->arg[i]];
+		}
+		case MEVE_OP_LOADT:
+		case MEVE_OP_STORE:
+		case MEVE_OP_POS:
+		{
+			return inc->vals[child[0]];
+		}
+		case MEVE_OP_NEG:
+		{
+			return -inc->vals[child[0]];
+		}
+		case MEVE_OP_ADD:
+		{
+			return inc->vals[child[0]] + inc->vals[child[1]];
+		}
+		case MEVE_OP_SUB:
+		{
+			return inc->vals[child[0]] - inc->vals[child[1]];
+		}
+		case MEVE_OP_MUL:
+		{
+			return inc->vals[child[0]] * inc->vals[child[1]];
+		}
+		case MEVE_OP_DIV:
+		{
+			return inc->vals[child[0]] / inc->vals[child[1]];
+		}
+		default:
+		{
+			arg[0] = inc->vals[child[0]];
+			arg[1] = MEVE_OP_ARITY(op) == 2 ? inc->vals[child[1]] : 0;
+
+			if (op == MEVE_OP_CALL1 || op == MEVE_OP_CALL2)
+			{
+				fPtr = prog->fPool[inc->arg[i]];
+			}
+			else
+			{
+				MeveOpCallback(op, &fPtr);
+			}
+			return fPtr(arg);
+		}
+	}
+}
+
+MeveCode MeveIncrInit(
+	const MEVE_PROGRAM* prog,
+	MEVE_INCR* inc)
+{
+	const size_t len = prog ? prog->len : 0;
+	const size_t words = (len + INCR_WORDBITS - 1) / INCR_WORDBITS;
+	const uint16_t* ap;
+	size_t sp = 0;
+	size_t edges = 0;
+	size_t loads = 0;
+	size_t dOff;
+	size_t cOff;
+	size_t aOff;
+	uint32_t* stack;
+	uint32_t* owner;
+	uint8_t* mem;
+
+	if (!prog || !prog->ops || !len || !inc)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	for (size_t i = 0; i < len; i++)
+	{
+		edges += MEVE_OP_ARITY(prog->ops[i]) + (prog->ops[i] == MEVE_OP_LOADT);
+		loads += prog->ops[i] == MEVE_OP_LOADV;
+	}
+
+	/* The evaluation stack and the slot owners are only used here and take
+	 * the place of the users, which are filled last. */
+	if (edges < len + prog->tLen)
+	{
+		edges = len + prog->tLen;
+	}
+
+	/* One block holds the values, the dirty set, the 32-bit lists and the
+	 * operand indices, each aligned to the size of its elements. */
+	dOff = ((len + prog->varCount) * sizeof(num_t) + sizeof(uint64_t) - 1) /
+		sizeof(uint64_t) * sizeof(uint64_t);
+	cOff = dOff + words * sizeof(uint64_t);
+	aOff = cOff + (2 * len + len + 1 + prog->varCount + 1 + loads + len + edges) * sizeof(uint32_t);
+
+	if (!(mem = malloc(aOff + len * sizeof(uint16_t))))
+	{
+		inc->vals = NULL;
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	inc->prog = prog;
+	inc->vals = (num_t*)mem;
+	inc->last = &inc->vals[len];
+	inc->dirty = (uint64_t*)&mem[dOff];
+	inc->child = (uint32_t*)&mem[cOff];
+	inc->uStart = &inc->child[2 * len];
+	inc->vStart = &inc->uStart[len + 1];
+	inc->vOps = &inc->vStart[prog->varCount + 1];
+	inc->calls = &inc->vOps[loads];
+	inc->users = &inc->calls[len];
+	inc->arg = (uint16_t*)&mem[aOff];
+	inc->cLen = 0;
+	inc->count = 0;
+	inc->valid = 0;
+	memset(inc->dirty, 0, words * sizeof(uint64_t));
+	memset(inc->uStart, 0, (len + 1) * sizeof(uint32_t));
+	memset(inc->vStart, 0, (prog->varCount + 1) * sizeof(uint32_t));
+
+	/* The operands are found by running the program on entry indices. A
+	 * temporary is read from the last entry that stored its slot. */
+	stack = inc->users;
+	owner = &stack[len];
+	ap = prog->args;
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		const uint8_t op = prog->ops[i];
+		const size_t arity = MEVE_OP_ARITY(op);
+		uint32_t* child = &inc->child[2 * i];
+
+		inc->arg[i] = MEVE_OP_HAS_ARG(op) ? *ap++ : 0;
+		child[1] = arity == 2 ? stack[--sp] : INCR_NONE;
+		child[0] = arity >= 1 ? stack[--sp] : INCR_NONE;
+
+		if (op == MEVE_OP_LOADT)
+		{
+			child[0] = owner[inc->arg[i]];
+		}
+		else if (op == MEVE_OP_STORE)
+		{
+			owner[inc->arg[i]] = i;
+		}
+		else if (op == MEVE_OP_LOADV)
+		{
+			inc->vStart[inc->arg[i]]++;
+		}
+		else if (op == MEVE_OP_CALL1 || op == MEVE_OP_CALL2)
+		{
+			inc->calls[inc->cLen++] = i;
+		}
+
+		for (size_t k = 0; k < 2; k++)
+		{
+			if (child[k] != INCR_NONE)
+			{
+				inc->uStart[child[k]]++;
+			}
+		}
+		stack[sp++] = i;
+	}
+
+	/* The counts become the ends of each list, and the lists are filled
+	 * backwards so that the ends move to their starts. */
+	for (size_t i = 0; i < len; i++)
+	{
+		inc->uStart[i + 1] += inc->uStart[i];
+	}
+
+	for (size_t i = 0; i < prog->varCount; i++)
+	{
+		inc->vStart[i + 1] += inc->vStart[i];
+	}
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		const uint32_t* child = &inc->child[2 * i];
+
+		for (size_t k = 0; k < 2; k++)
+		{
+			if (child[k] != INCR_NONE)
+			{
+				inc->users[--inc->uStart[child[k]]] = i;
+			}
+		}
+
+		if (prog->ops[i] == MEVE_OP_LOADV)
+		{
+			inc->vOps[--inc->vStart[inc->arg[i]]] = i;
+		}
+	}
+
+	return MEVE_ERR_OK;
+}
+
+MeveCode MeveIncrRun(
+	MEVE_INCR* inc,
+	num_t* res)
+{
+	const MEVE_PROGRAM* prog;
+	size_t words;
+	size_t first;
+
+	if (!inc || !inc->vals || !res)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	prog = inc->prog;
+	words = (prog->len + INCR_WORDBITS - 1) / INCR_WORDBITS;
+	first = words;
+
+	/* The first run evaluates every entry in program order. */
+	if (!inc->valid)
+	{
+		for (size_t v = 0; v < prog->varCount; v++)
+		{
+			inc->last[v] = *prog->vars[v].ptr;
+		}
+
+		for (uint32_t i = 0; i < prog->len; i++)
+		{
+			inc->vals[i] = IncrEval(inc, i);
+		}
+
+		inc->count = prog->len;
+		inc->valid = 1;
+		*res = inc->vals[prog->len - 1];
+		return MEVE_ERR_OK;
+	}
+
+	for (size_t v = 0; v < prog->varCount; v++)
+	{
+		const num_t val = *prog->vars[v].ptr;
+
+		if (!IncrSame(val, inc->last[v]))
+		{
+			inc->last[v] = val;
+
+			for (uint32_t k = inc->vStart[v]; k < inc->vStart[v + 1]; k++)
+			{
+				IncrMark(inc, inc->vOps[k], &first);
+			}
+		}
+	}
+
+	for (size_t k = 0; k < inc->cLen; k++)
+	{
+		IncrMark(inc, inc->calls[k], &first);
+	}
+
+	/* An entry is only read by later entries, so one forward sweep of the
+	 * dirty set reaches every entry marked on the way. */
+	inc->count = 0;
+
+	for (size_t w = first; w < words; w++)
+	{
+		while (inc->dirty[w])
+		{
+			const uint32_t i = (uint32_t)(w * INCR_WORDBITS + IncrLowBit(inc->dirty[w]));
+			const num_t val = IncrEval(inc, i);
+
+			inc->dirty[w] &= inc->dirty[w] - 1;
+			inc->count++;
+
+			if (!IncrSame(val, inc->vals[i]))
+			{
+				inc->vals[i] = val;
+
+				for (uint32_t k = inc->uStart[i]; k < inc->uStart[i + 1]; k++)
+				{
+					IncrMark(inc, inc->users[k], &first);
+				}
+			}
+		}
+	}
+
+	*res = inc->vals[prog->len - 1];
+	return MEVE_ERR_OK;
+}
+
+void MeveIncrFree(
+	MEVE_INCR* inc)
+{
+	/* The other arrays share the block of the values. */
+	free(inc->vals);
+	inc->prog = NULL;
+	inc->vals = NULL;
+	inc->cLen = 0;
+	inc->count = 0;
+	inc->valid = 0;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef MEVEINCR_H
+#define MEVEINCR_H
+#include "meve.h"
+
+/* Incremental evaluation state of a program.	*/
+typedef struct MEVE_INCR
+{
+	const MEVE_PROGRAM* prog;	/* Pointer to the source program.		*/
+	num_t* vals;				/* Last value of each entry.			*/
+	num_t* last;				/* Variable values of the last run.		*/
+	uint32_t* child;			/* Two operand entries per entry.		*/
+	uint16_t* arg;				/* Operand stream index of each entry.	*/
+	uint32_t* uStart;			/* First reader of each entry in users.	*/
+	uint32_t* users;			/* Entries reading each entry.			*/
+	uint32_t* vStart;			/* First loader of each variable in vOps.	*/
+	uint32_t* vOps;				/* Entries loading each variable.		*/
+	uint32_t* calls;			/* Entries calling a callback.			*/
+	size_t cLen;				/* Number of callback entries.			*/
+	uint64_t* dirty;			/* Entries to evaluate, one bit each.	*/
+	size_t count;				/* Entries evaluated by the last run.	*/
+	uint8_t valid;				/* Whether vals holds a full evaluation.	*/
+}MEVE_INCR;
+
+/* Prepares the incremental evaluation of a compiled program.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The program must outlive the state, which must be released by calling
+ * MeveIncrFree(). The dependencies of every entry are found once here:
+ * the entries reading each entry, and the entries loading each variable.
+*/
+MeveCode MeveIncrInit(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	MEVE_INCR* inc);			/* Pointer to the state to be filled.	*/
+
+/* Evaluates a compiled program again after some variables changed.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The first run evaluates every entry and keeps its value. The next ones
+ * compare the variables with the values they had in the previous run and
+ * only evaluate the entries that depend on a changed variable. An entry
+ * whose value does not change stops the propagation to the entries
+ * reading it, so max(x, 100) does not invalidate its readers while x
+ * stays below 100. The entries with MEVE_OP_CALL1 or MEVE_OP_CALL2 may
+ * have side effects and are evaluated on every run.
+ * Changes to the constant pool, such as the parameters of a program of
+ * MeveCompileParams(), are not seen; MeveIncrInit() must be called again.
+ * inc->count receives the number of entries evaluated.
+*/
+MeveCode MeveIncrRun(
+	MEVE_INCR* inc,				/* Pointer to an incremental state.		*/
+	num_t* res);				/* Receives the result.					*/
+
+/* Releases the resources of an incremental state.
+ *
+ * Remarks:
+ * The inc pointer cannot be null. Releasing an empty state is allowed.
+*/
+void MeveIncrFree(
+	MEVE_INCR* inc);			/* Pointer to an incremental state.		*/
+#endif
\ No newline at end of file
@@ -0,0 +1,787 @@
+#include "meveival.h"
+#include "mevemath.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define IVAL_PI					3.141592653589793238462643383279502884L	/* pi.		*/
+#define IVAL_PI_2				1.570796326794896619231321691639751442L	/* pi / 2.	*/
+
+#define IVAL_FUNC_ULPS			4	/* Error allowed to the math library.	*/
+#define IVAL_GAMMA_ULPS			16	/* Error allowed to the gamma function.	*/
+
+/* Argument and value of the minimum of Gamma(x + 1) for x >= 0.	*/
+#define IVAL_FACT_MINARG		0.4616321449683623412626595423257213284L
+#define IVAL_FACT_MINVAL		0.8856031944108887002788159005825887332L
+
+static MEVE_INTERVAL IvalMake(
+	const num_t lo,
+	const num_t hi)
+{
+	MEVE_INTERVAL r;
+
+	r.lo = lo;
+	r.hi = hi;
+	r.nan = 0;
+	return r;
+}
+
+/* No input gives a number. */
+static MEVE_INTERVAL IvalEmpty(void)
+{
+	MEVE_INTERVAL r = IvalMake((num_t)NAN, (num_t)NAN);
+
+	r.nan = 1;
+	return r;
+}
+
+static MEVE_INTERVAL IvalEntire(void)
+{
+	return IvalMake(-(num_t)INFINITY, (num_t)INFINITY);
+}
+
+static bool IvalIsEmpty(
+	const MEVE_INTERVAL* a)
+{
+	return isnan(a->lo) || isnan(a->hi);
+}
+
+static bool IvalIsPoint(
+	const MEVE_INTERVAL* a)
+{
+	return a->lo == a->hi;
+}
+
+static bool IvalHas(
+	const MEVE_INTERVAL* a,
+	const num_t x)
+{
+	return a->lo <= x && x <= a->hi;
+}
+
+static bool IvalIsBounded(
+	const MEVE_INTERVAL* a)
+{
+	return !isinf(a->lo) && !isinf(a->hi);
+}
+
+/* Extends r to contain [lo, hi]. */
+static MEVE_INTERVAL IvalHull(
+	MEVE_INTERVAL r,
+	const num_t lo,
+	const num_t hi)
+{
+	if (IvalIsEmpty(&r))
+	{
+		r.lo = lo;
+		r.hi = hi;
+	}
+	else
+	{
+		r.lo = MEVE_MATH(fmin)(r.lo, lo);
+		r.hi = MEVE_MATH(fmax)(r.hi, hi);
+	}
+	return r;
+}
+
+/* Moves the bounds one ulp outwards, which covers a correctly rounded
+ * operation. */
+static MEVE_INTERVAL IvalOut(
+	MEVE_INTERVAL r)
+{
+	r.lo = MEVE_MATH(nextafter)(r.lo, -(num_t)INFINITY);
+	r.hi = MEVE_MATH(nextafter)(r.hi, (num_t)INFINITY);
+	return r;
+}
+
+/* Moves the bounds ulps units of relative error outwards. */
+static MEVE_INTERVAL IvalWiden(
+	MEVE_INTERVAL r,
+	const num_t ulps)
+{
+	const num_t f = ulps * MEVE_NUM_EPSILON;
+
+	if (isfinite(r.lo) && r.lo != 0)
+	{
+		r.lo -= MEVE_MATH(fabs)(r.lo) * f;
+	}
+
+	if (isfinite(r.hi) && r.hi != 0)
+	{
+		r.hi += MEVE_MATH(fabs)(r.hi) * f;
+	}
+	return IvalOut(r);
+}
+
+/* Bounds that are not numbers come from operations such as inf - inf,
+ * which can take any value. */
+static MEVE_INTERVAL IvalCover(
+	const MEVE_INTERVAL r)
+{
+	MEVE_INTERVAL c = IvalEntire();
+
+	if (!IvalIsEmpty(&r))
+	{
+		return r;
+	}
+	c.nan = 1;
+	return c;
+}
+
+/* Products where a zero bound meets an infinite one are 0. */
+static num_t IvalMulBound(
+	const num_t a,
+	const num_t b)
+{
+	return a == 0 || b == 0 ? 0 : a * b;
+}
+
+/* Whether [lo, hi] may contain offset + k * period for an integer k.
+ * The rounding of the quotients is covered by a margin, so the answer
+ * can be true when it is not, but never the opposite. */
+static bool IvalHasPoint(
+	const num_t lo,
+	const num_t hi,
+	const num_t offset,
+	const num_t period)
+{
+	const num_t t0 = (lo - offset) / period;
+	const num_t t1 = (hi - offset) / period;
+	const num_t slack = 8 * MEVE_NUM_EPSILON * (MEVE_MATH(fabs)(t0) + MEVE_MATH(fabs)(t1) + 1);
+
+	return !isfinite(t0) || !isfinite(t1) ||
+		MEVE_MATH(floor)(t1 + slack) >= MEVE_MATH(ceil)(t0 - slack);
+}
+
+/* Sine and cosine, whose maxima are at peak + 2k * pi. */
+static MEVE_INTERVAL IvalPeriodic(
+	const MEVE_INTERVAL* a,
+	num_t(*fn)(num_t),
+	const num_t peak)
+{
+	MEVE_INTERVAL r;
+	num_t y0;
+	num_t y1;
+
+	/* sin(inf) is NaN. */
+	if (!IvalIsBounded(a))
+	{
+		r = IvalMake(-1, 1);
+		r.nan = 1;
+		return r;
+	}
+
+	y0 = fn(a->lo);
+	y1 = fn(a->hi);
+	r = IvalWiden(IvalMake(MEVE_MATH(fmin)(y0, y1), MEVE_MATH(fmax)(y0, y1)), IVAL_FUNC_ULPS);
+
+	if (IvalHasPoint(a->lo, a->hi, peak, 2 * (num_t)IVAL_PI))
+	{
+		r.hi = 1;
+	}
+
+	if (IvalHasPoint(a->lo, a->hi, peak + (num_t)IVAL_PI, 2 * (num_t)IVAL_PI))
+	{
+		r.lo = -1;
+	}
+
+	r.lo = MEVE_MATH(fmax)(r.lo, -1);
+	r.hi = MEVE_MATH(fmin)(r.hi, 1);
+	return r;
+}
+
+/* Increasing function over the part of a within [lo, hi], its domain. */
+static MEVE_INTERVAL IvalIncreasing(
+	const MEVE_INTERVAL* a,
+	num_t(*fn)(num_t),
+	const num_t lo,
+	const num_t hi)
+{
+	const num_t x0 = MEVE_MATH(fmax)(a->lo, lo);
+	const num_t x1 = MEVE_MATH(fmin)(a->hi, hi);
+	MEVE_INTERVAL r;
+
+	if (!(x0 <= x1))
+	{
+		return IvalEmpty();
+	}
+
+	r = IvalWiden(IvalMake(fn(x0), fn(x1)), IVAL_FUNC_ULPS);
+	r.nan = a->lo < lo || a->hi > hi;
+	return r;
+}
+
+static MEVE_INTERVAL IvalFactorial(
+	const MEVE_INTERVAL* a)
+{
+	const num_t lo = MEVE_MATH(fmax)(a->lo, 0);
+	num_t y0;
+	num_t y1;
+	MEVE_INTERVAL r;
+
+	/* Negative arguments, and NaN, return 0. */
+	if (IvalIsEmpty(a) || a->hi < 0)
+	{
+		return IvalMake(0, 0);
+	}
+
+	y0 = Factorial(&lo);
+	y1 = Factorial(&a->hi);
+
+	/* Gamma(x + 1) decreases down to its minimum and increases after. */
+	if (lo <= IVAL_FACT_MINARG && IVAL_FACT_MINARG <= a->hi)
+	{
+		r = IvalMake((num_t)IVAL_FACT_MINVAL, MEVE_MATH(fmax)(y0, y1));
+	}
+	else
+	{
+		r = IvalMake(MEVE_MATH(fmin)(y0, y1), MEVE_MATH(fmax)(y0, y1));
+	}
+
+	/* The table holds sequential products, which round once per
+	 * factor. */
+	r = IvalWiden(r, IVAL_GAMMA_ULPS + a->hi);
+	r.lo = a->lo < 0 || a->nan ? 0 : MEVE_MATH(fmax)(r.lo, 0);
+	return r;
+}
+
+static MEVE_INTERVAL IvalUnary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	const MEVE_INTERVAL* a)
+{
+	MEVE_INTERVAL r;
+
+	if (op == MEVE_OP_FACT)
+	{
+		return IvalFactorial(a);
+	}
+	else if (IvalIsEmpty(a))
+	{
+		return IvalEmpty();
+	}
+
+	switch (op)
+	{
+		case MEVE_OP_POS:
+		{
+			return *a;
+		}
+		case MEVE_OP_NEG:
+		{
+			r = IvalMake(-a->hi, -a->lo);
+			break;
+		}
+		case MEVE_OP_EXP:
+		{
+			r = IvalIncreasing(a, &MEVE_MATH(exp), -(num_t)INFINITY, (num_t)INFINITY);
+			r.lo = MEVE_MATH(fmax)(r.lo, 0);
+			break;
+		}
+		case MEVE_OP_SQRT:
+		{
+			/* sqrt() is correctly rounded. */
+			if (a->hi < 0)
+			{
+				return IvalEmpty();
+			}
+			r = IvalOut(IvalMake(MEVE_MATH(sqrt)(MEVE_MATH(fmax)(a->lo, 0)), MEVE_MATH(sqrt)(a->hi)));
+			r.lo = MEVE_MATH(fmax)(r.lo, 0);
+			r.nan = a->lo < 0;
+			break;
+		}
+		case MEVE_OP_ABS:
+		{
+			if (a->lo >= 0)
+			{
+				return *a;
+			}
+			else if (a->hi <= 0)
+			{
+				r = IvalMake(-a->hi, -a->lo);
+			}
+			else
+			{
+				r = IvalMake(0, MEVE_MATH(fmax)(-a->lo, a->hi));
+			}
+			break;
+		}
+		case MEVE_OP_SIN:
+		{
+			r = IvalPeriodic(a, &MEVE_MATH(sin), (num_t)IVAL_PI_2);
+			break;
+		}
+		case MEVE_OP_COS:
+		{
+			r = IvalPeriodic(a, &MEVE_MATH(cos), 0);
+			break;
+		}
+		case MEVE_OP_TAN:
+		{
+			/* Increasing between the poles at pi / 2 + k * pi. */
+			if (IvalHasPoint(a->lo, a->hi, (num_t)IVAL_PI_2, (num_t)IVAL_PI))
+			{
+				r = IvalEntire();
+				r.nan = !IvalIsBounded(a);
+			}
+			else
+			{
+				r = IvalIncreasing(a, &MEVE_MATH(tan), a->lo, a->hi);
+			}
+			break;
+		}
+		case MEVE_OP_ASIN:
+		{
+			r = IvalIncreasing(a, &MEVE_MATH(asin), -1, 1);
+			r.lo = MEVE_MATH(fmax)(r.lo, -(num_t)IVAL_PI_2 * (1 + MEVE_NUM_EPSILON));
+			r.hi = MEVE_MATH(fmin)(r.hi, (num_t)IVAL_PI_2 * (1 + MEVE_NUM_EPSILON));
+			break;
+		}
+		case MEVE_OP_ACOS:
+		{
+			/* Decreasing, so the bounds are swapped. */
+			const num_t x0 = MEVE_MATH(fmax)(a->lo, -1);
+			const num_t x1 = MEVE_MATH(fmin)(a->hi, 1);
+
+			if (!(x0 <= x1))
+			{
+				return IvalEmpty();
+			}
+			r = IvalWiden(IvalMake(MEVE_MATH(acos)(x1), MEVE_MATH(acos)(x0)), IVAL_FUNC_ULPS);
+			r.lo = MEVE_MATH(fmax)(r.lo, 0);
+			r.nan = a->lo < -1 || a->hi > 1;
+			break;
+		}
+		case MEVE_OP_ATAN:
+		{
+			r = IvalIncreasing(a, &MEVE_MATH(atan), -(num_t)INFINITY, (num_t)INFINITY);
+			break;
+		}
+		case MEVE_OP_LOG10:
+		{
+			r = IvalIncreasing(a, &MEVE_MATH(log10), 0, (num_t)INFINITY);
+			break;
+		}
+		case MEVE_OP_LOG:
+		{
+			r = IvalIncreasing(a, &MEVE_MATH(log), 0, (num_t)INFINITY);
+			break;
+		}
+		default:
+		{
+			/* Nothing is known about a callback but its value. */
+			num_t val;
+
+			if (!IvalIsPoint(a))
+			{
+				r = IvalEntire();
+				r.nan = 1;
+				break;
+			}
+			val = fPtr(&a->lo);
+			r = IvalCover(IvalWiden(IvalMake(val, val), IVAL_FUNC_ULPS));
+		}
+	}
+
+	r.nan |= a->nan;
+	return r;
+}
+
+static MEVE_INTERVAL IvalMul(
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	const num_t p[4] =
+	{
+		IvalMulBound(a->lo, b->lo), IvalMulBound(a->lo, b->hi),
+		IvalMulBound(a->hi, b->lo), IvalMulBound(a->hi, b->hi)
+	};
+	MEVE_INTERVAL r = IvalOut(IvalMake(
+		MEVE_MATH(fmin)(MEVE_MATH(fmin)(p[0], p[1]), MEVE_MATH(fmin)(p[2], p[3])),
+		MEVE_MATH(fmax)(MEVE_MATH(fmax)(p[0], p[1]), MEVE_MATH(fmax)(p[2], p[3]))));
+
+	/* 0 * inf. */
+	r.nan = (IvalHas(a, 0) && !IvalIsBounded(b)) || (IvalHas(b, 0) && !IvalIsBounded(a));
+	return r;
+}
+
+static MEVE_INTERVAL IvalDiv(
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	/* 0 / 0 and inf / inf. */
+	const bool nan = (IvalHas(a, 0) && IvalHas(b, 0)) || (!IvalIsBounded(a) && !IvalIsBounded(b));
+	MEVE_INTERVAL r = IvalEntire();
+	num_t q[4];
+
+	/* A divisor that can be 0 leaves the quotient unbounded. */
+	if (!IvalHas(b, 0))
+	{
+		q[0] = a->lo / b->lo;
+		q[1] = a->lo / b->hi;
+		q[2] = a->hi / b->lo;
+		q[3] = a->hi / b->hi;
+
+		if (!isnan(q[0]) && !isnan(q[1]) && !isnan(q[2]) && !isnan(q[3]))
+		{
+			r = IvalOut(IvalMake(
+				MEVE_MATH(fmin)(MEVE_MATH(fmin)(q[0], q[1]), MEVE_MATH(fmin)(q[2], q[3])),
+				MEVE_MATH(fmax)(MEVE_MATH(fmax)(q[0], q[1]), MEVE_MATH(fmax)(q[2], q[3]))));
+		}
+	}
+
+	r.nan = nan;
+	return r;
+}
+
+static MEVE_INTERVAL IvalMod(
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	/* fmod(x, y) has the sign of x and a magnitude below |y|. */
+	const num_t m = MEVE_MATH(fmax)(MEVE_MATH(fabs)(b->lo), MEVE_MATH(fabs)(b->hi));
+	MEVE_INTERVAL r;
+
+	/* fmod(x, 0) and fmod(inf, y) are NaN. */
+	if (m == 0 || (isinf(a->lo) && a->lo == a->hi))
+	{
+		return IvalEmpty();
+	}
+
+	/* Within one period of a constant divisor fmod() is an exact and
+	 * increasing function of x. The rounded quotients may miss a multiple
+	 * of the divisor next to an end, which the remainders then reverse. */
+	if (IvalIsPoint(b) && IvalIsBounded(a) && (a->lo >= 0 || a->hi <= 0) &&
+		MEVE_MATH(trunc)(a->lo / b->lo) == MEVE_MATH(trunc)(a->hi / b->lo) &&
+		MEVE_MATH(fmod)(a->lo, b->lo) <= MEVE_MATH(fmod)(a->hi, b->lo))
+	{
+		r = IvalMake(MEVE_MATH(fmod)(a->lo, b->lo), MEVE_MATH(fmod)(a->hi, b->lo));
+	}
+	else
+	{
+		r = IvalMake(a->lo >= 0 ? 0 : MEVE_MATH(fmax)(a->lo, -m), a->hi <= 0 ? 0 : MEVE_MATH(fmin)(a->hi, m));
+	}
+
+	r.nan = IvalHas(b, 0) || !IvalIsBounded(a);
+	return r;
+}
+
+static MEVE_INTERVAL IvalChoose(
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	MEVE_INTERVAL r;
+
+	/* A NaN operand gives NaN, 0, 1 when k is 0 or inf when n is. */
+	if (IvalIsEmpty(a) || IvalIsEmpty(b))
+	{
+		r = IvalMake(0, a->hi == (num_t)INFINITY ? a->hi : 1);
+		r.nan = 1;
+		return r;
+	}
+	else if (a->hi < 0 || b->hi < 0 || b->lo > a->hi)
+	{
+		/* Out of 0 <= k <= n the result is 0. */
+		r = IvalMake(0, 0);
+	}
+	else if (IvalIsPoint(a) && IvalIsPoint(b))
+	{
+		/* The lgamma path loses about n * log(n) ulps. */
+		const num_t arg[2] = { a->lo, b->lo };
+		const num_t val = Choose(arg);
+
+		r = IvalCover(IvalWiden(IvalMake(val, val), IVAL_GAMMA_ULPS * (1 + a->lo * MEVE_MATH(log)(a->lo + 1))));
+		r.lo = MEVE_MATH(fmax)(r.lo, 0);
+	}
+	else
+	{
+		const num_t arg = a->hi + 1;
+
+		/* n choose k is at most 2^n, also for non-integers. */
+		r = IvalMake(0, IvalWiden(IvalMake(1, MEVE_MATH(exp2)(MEVE_MATH(fmax)(a->hi, 0))), IVAL_FUNC_ULPS).hi);
+
+		/* lgamma() overflows before n does. */
+		r.nan = isinf(LogGamma(&arg));
+	}
+
+	if (a->nan || b->nan)
+	{
+		r = IvalHull(r, 0, a->hi == (num_t)INFINITY ? a->hi : 1);
+		r.nan = 1;
+	}
+	return r;
+}
+
+static MEVE_INTERVAL IvalPow(
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	MEVE_INTERVAL base = *a;
+	MEVE_INTERVAL r;
+	num_t p[4];
+
+	/* Integer and infinite exponents are defined for every base. */
+	if (IvalIsPoint(b) && MEVE_MATH(floor)(b->lo) == b->lo)
+	{
+		const num_t n = b->lo;
+		const bool odd = isfinite(n) && MEVE_MATH(fmod)(n, 2) != 0;
+
+		if (n == 0)
+		{
+			return IvalMake(1, 1);
+		}
+		else if (!odd)
+		{
+			/* Even powers are functions of |x|. */
+			base = IvalUnary(MEVE_OP_ABS, NULL, a);
+		}
+		else if (n < 0 && a->lo <= 0 && a->hi >= 0 && a->lo != 0)
+		{
+			/* Odd negative powers have a pole at 0. */
+			return IvalEntire();
+		}
+
+		p[0] = MEVE_MATH(pow)(base.lo, n);
+		p[1] = MEVE_MATH(pow)(base.hi, n);
+
+		return IvalCover(IvalWiden(IvalMake(MEVE_MATH(fmin)(p[0], p[1]), MEVE_MATH(fmax)(p[0], p[1])), IVAL_FUNC_ULPS));
+	}
+	else if (a->lo < 0 || signbit(a->lo))
+	{
+		/* Negative bases are only defined for integer exponents, and -0
+		 * has the poles of odd negative powers at -inf. */
+		if (!IvalIsPoint(b))
+		{
+			r = IvalEntire();
+			r.nan = 1;
+			return r;
+		}
+		else if (a->lo == -(num_t)INFINITY)
+		{
+			/* pow(-inf, y) is +inf or +0. */
+			p[0] = MEVE_MATH(pow)(a->lo, b->lo);
+			base.lo = 0;
+			r = a->hi < 0 ? IvalMake(p[0], p[0]) : IvalHull(IvalPow(&base, b), p[0], p[0]);
+			r.nan = 1;
+			return r;
+		}
+		else if (a->hi < 0)
+		{
+			return IvalEmpty();
+		}
+		base.lo = 0;
+	}
+
+	/* For x >= 0, x^y is monotone in each argument, so its extremes are
+	 * at the corners. */
+	p[0] = MEVE_MATH(pow)(base.lo, b->lo);
+	p[1] = MEVE_MATH(pow)(base.lo, b->hi);
+	p[2] = MEVE_MATH(pow)(base.hi, b->lo);
+	p[3] = MEVE_MATH(pow)(base.hi, b->hi);
+
+	r = IvalCover(IvalWiden(IvalMake(
+		MEVE_MATH(fmax)(MEVE_MATH(fmin)(MEVE_MATH(fmin)(p[0], p[1]), MEVE_MATH(fmin)(p[2], p[3])), 0),
+		MEVE_MATH(fmax)(MEVE_MATH(fmax)(p[0], p[1]), MEVE_MATH(fmax)(p[2], p[3]))), IVAL_FUNC_ULPS));
+	r.nan |= a->lo < 0;
+	return r;
+}
+
+static MEVE_INTERVAL IvalBinary(
+	const uint8_t op,
+	num_t(*fPtr)(const num_t*),
+	const MEVE_INTERVAL* a,
+	const MEVE_INTERVAL* b)
+{
+	MEVE_INTERVAL r;
+
+	/* Like fmin() and fmax(), min and max return the other operand where
+	 * one is NaN. */
+	if (op == MEVE_OP_MIN || op == MEVE_OP_MAX)
+	{
+		if (IvalIsEmpty(a) || IvalIsEmpty(b))
+		{
+			r = IvalIsEmpty(a) ? *b : *a;
+		}
+		else
+		{
+			r = op == MEVE_OP_MIN
+				? IvalMake(MEVE_MATH(fmin)(a->lo, b->lo), MEVE_MATH(fmin)(a->hi, b->hi))
+				: IvalMake(MEVE_MATH(fmax)(a->lo, b->lo), MEVE_MATH(fmax)(a->hi, b->hi));
+
+			if (a->nan)
+			{
+				r = IvalHull(r, b->lo, b->hi);
+			}
+
+			if (b->nan)
+			{
+				r = IvalHull(r, a->lo, a->hi);
+			}
+		}
+		r.nan = a->nan && b->nan;
+		return r;
+	}
+	else if (op == MEVE_OP_CHOOSE)
+	{
+		return IvalChoose(a, b);
+	}
+	else if (op == MEVE_OP_POW)
+	{
+		/* pow(x, 0) and pow(1, y) are 1 even for a NaN x or y. */
+		const bool one = (a->nan && IvalHas(b, 0)) || (b->nan && IvalHas(a, 1));
+
+		r = IvalIsEmpty(a) || IvalIsEmpty(b) ? IvalEmpty() : IvalPow(a, b);
+
+		if (one)
+		{
+			r = IvalHull(r, 1, 1);
+		}
+		r.nan |= a->nan || b->nan;
+		return r;
+	}
+	else if (IvalIsEmpty(a) || IvalIsEmpty(b))
+	{
+		return IvalEmpty();
+	}
+
+	switch (op)
+	{
+		case MEVE_OP_ADD:
+		{
+			/* inf - inf. */
+			r = IvalCover(IvalOut(IvalMake(a->lo + b->lo, a->hi + b->hi)));
+			r.nan |= (a->hi == (num_t)INFINITY && b->lo == -(num_t)INFINITY) ||
+				(a->lo == -(num_t)INFINITY && b->hi == (num_t)INFINITY);
+			break;
+		}
+		case MEVE_OP_SUB:
+		{
+			r = IvalCover(IvalOut(IvalMake(a->lo - b->hi, a->hi - b->lo)));
+			r.nan |= (a->hi == (num_t)INFINITY && b->hi == (num_t)INFINITY) ||
+				(a->lo == -(num_t)INFINITY && b->lo == -(num_t)INFINITY);
+			break;
+		}
+		case MEVE_OP_MUL:
+		{
+			r = IvalMul(a, b);
+			break;
+		}
+		case MEVE_OP_DIV:
+		{
+			r = IvalDiv(a, b);
+			break;
+		}
+		case MEVE_OP_MOD:
+		{
+			r = IvalMod(a, b);
+			break;
+		}
+		default:
+		{
+			const num_t arg[2] = { a->lo, b->lo };
+			num_t val;
+
+			if (!IvalIsPoint(a) || !IvalIsPoint(b))
+			{
+				r = IvalEntire();
+				r.nan = 1;
+				break;
+			}
+			val = fPtr(arg);
+			r = IvalCover(IvalWiden(IvalMake(val, val), IVAL_FUNC_ULPS));
+		}
+	}
+
+	r.nan |= a->nan || b->nan;
+	return r;
+}
+
+MeveCode MeveRunInterval(
+	const MEVE_PROGRAM* prog,
+	const MEVE_INTERVAL* box,
+	MEVE_INTERVAL* res)
+{
+	MEVE_INTERVAL buff[MAXLEN_TBUFFER];
+	MEVE_INTERVAL* stack = buff;
+	const uint16_t* ap;
+	size_t sp = 0;
+
+	if (!prog || !prog->ops || !res || (prog->varCount && !box))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	for (size_t i = 0; i < prog->varCount; i++)
+	{
+		if (box[i].lo > box[i].hi)
+		{
+			return MEVE_ERR_INVALIDPARAM;
+		}
+	}
+
+	/* The temporaries follow the evaluation stack. */
+	if (prog->depth + prog->tLen > MAXLEN_TBUFFER &&
+		!(stack = malloc((prog->depth + prog->tLen) * sizeof(MEVE_INTERVAL))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	ap = prog->args;
+
+	for (const uint8_t* pc = prog->ops; *pc != MEVE_OP_RET; pc++)
+	{
+		const uint16_t arg = MEVE_OP_HAS_ARG(*pc) ? *ap++ : 0;
+		num_t(*fPtr)(const num_t*) = NULL;
+
+		if (*pc == MEVE_OP_CALL1 || *pc == MEVE_OP_CALL2)
+		{
+			fPtr = prog->fPool[arg];
+		}
+
+		switch (MEVE_OP_ARITY(*pc))
+		{
+			case 0:
+			{
+				if (*pc == MEVE_OP_LOADT)
+				{
+					stack[sp] = stack[prog->depth + arg];
+				}
+				else
+				{
+					const num_t lo = *pc == MEVE_OP_PUSHK ? prog->kPool[arg] : box[arg].lo;
+					const num_t hi = *pc == MEVE_OP_PUSHK ? prog->kPool[arg] : box[arg].hi;
+
+					stack[sp] = IvalMake(lo, hi);
+					stack[sp].nan = isnan(lo) || isnan(hi);
+				}
+				sp++;
+				break;
+			}
+			case 1:
+			{
+				if (*pc == MEVE_OP_STORE)
+				{
+					stack[prog->depth + arg] = stack[sp - 1];
+				}
+				else
+				{
+					stack[sp - 1] = IvalUnary(*pc, fPtr, &stack[sp - 1]);
+				}
+				break;
+			}
+			default:
+			{
+				sp--;
+				stack[sp - 1] = IvalBinary(*pc, fPtr, &stack[sp - 1], &stack[sp]);
+			}
+		}
+	}
+
+	*res = sp ? stack[0] : IvalEmpty();
+
+	if (stack != buff)
+	{
+		free(stack);
+	}
+	return MEVE_ERR_OK;
+}
\ No newline at end of file
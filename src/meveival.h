@@ -0,0 +1,36 @@
+#ifndef MEVEIVAL_H
+#define MEVEIVAL_H
+#include "meve.h"
+
+/* Closed interval.						*/
+typedef struct MEVE_INTERVAL
+{
+	num_t lo;					/* Lower bound.							*/
+	num_t hi;					/* Upper bound.							*/
+	uint8_t nan;				/* Whether some inputs give NaN.		*/
+}MEVE_INTERVAL;
+
+/* Bounds a compiled program over a box of inputs.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * box[i] is the range of the variable prog->vars[i], so box must have
+ * prog->varCount entries, each with lo <= hi. The program is evaluated
+ * once with intervals, and every value the program can take for inputs
+ * in the box lies in res.
+ * The bounds are rounded outwards: the results of the arithmetic are
+ * widened by one ulp and the ones of the math library by a few ulps, so
+ * the result may be slightly wider than the exact range but never
+ * narrower. The bounds only cover the results that are numbers: when
+ * some inputs of the box are outside the domain of a function, res->nan
+ * is set, and the bounds are NaN when every input is. The nan field of
+ * the box is ignored.
+ * The entries with MEVE_OP_CALL1 or MEVE_OP_CALL2 can only be bounded
+ * when their arguments are single points, and are unbounded otherwise.
+*/
+MeveCode MeveRunInterval(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	const MEVE_INTERVAL* box,	/* Pointer to the variable ranges.		*/
+	MEVE_INTERVAL* res);		/* Receives the bounds of the result.	*/
+#endif
\ No newline at end of file
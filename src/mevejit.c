@@ -0,0 +1,408 @@
+#include "mevejit.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef MEVE_JIT_NATIVE
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JIT_MAXLEN_INSTR		32	/* Largest native sequence per instruction.	*/
+#define JIT_MAXLEN_FRAME		24	/* Prologue and epilogue length.	*/
+
+/* Address of a callee.				*/
+typedef void(*JIT_FUNC)(void);
+
+/* Native code buffer.					*/
+typedef struct JIT_BUFFER
+{
+	uint8_t* code;				/* Pointer to the code being emitted.	*/
+	size_t len;					/* Current code length.					*/
+	size_t pool;				/* Offset of the constant pool.			*/
+}JIT_BUFFER;
+
+static void Emit(
+	JIT_BUFFER* buff,
+	const uint8_t* bytes,
+	const size_t len)
+{
+	memcpy(&buff->code[buff->len], bytes, len);
+	buff->len += len;
+}
+
+static void Emit32(
+	JIT_BUFFER* buff,
+	const uint32_t val)
+{
+	const uint8_t bytes[] =
+	{
+		(uint8_t)val, (uint8_t)(val >> 8), (uint8_t)(val >> 16), (uint8_t)(val >> 24)
+	};
+	Emit(buff, bytes, sizeof(bytes));
+}
+
+static void Emit64(
+	JIT_BUFFER* buff,
+	const uint64_t val)
+{
+	Emit32(buff, (uint32_t)val);
+	Emit32(buff, (uint32_t)(val >> 32));
+}
+
+/* movsd xmm, [rsp + 8 * slot]			*/
+static void EmitLoadSlot(
+	JIT_BUFFER* buff,
+	const uint8_t xmm,
+	const size_t slot)
+{
+	const uint8_t op[] = { 0xF2, 0x0F, 0x10, (uint8_t)(0x84 | (xmm << 3)), 0x24 };
+
+	Emit(buff, op, sizeof(op));
+	Emit32(buff, (uint32_t)(slot * sizeof(num_t)));
+}
+
+/* movsd [rsp + 8 * slot], xmm0			*/
+static void EmitStoreSlot(
+	JIT_BUFFER* buff,
+	const size_t slot)
+{
+	const uint8_t op[] = { 0xF2, 0x0F, 0x11, 0x84, 0x24 };
+
+	Emit(buff, op, sizeof(op));
+	Emit32(buff, (uint32_t)(slot * sizeof(num_t)));
+}
+
+/* lea rdi, [rsp + 8 * slot]			*/
+static void EmitArgSlot(
+	JIT_BUFFER* buff,
+	const size_t slot)
+{
+	const uint8_t op[] = { 0x48, 0x8D, 0xBC, 0x24 };
+
+	Emit(buff, op, sizeof(op));
+	Emit32(buff, (uint32_t)(slot * sizeof(num_t)));
+}
+
+/* mov rax, imm64						*/
+static void EmitMovRax(
+	JIT_BUFFER* buff,
+	const uint64_t val)
+{
+	const uint8_t op[] = { 0x48, 0xB8 };
+
+	Emit(buff, op, sizeof(op));
+	Emit64(buff, val);
+}
+
+/* mov rax, fPtr; call rax				*/
+static void EmitCall(
+	JIT_BUFFER* buff,
+	JIT_FUNC fPtr)
+{
+	const uint8_t op[] = { 0xFF, 0xD0 };
+
+	EmitMovRax(buff, (uint64_t)(uintptr_t)fPtr);
+	Emit(buff, op, sizeof(op));
+}
+
+/* Moves the top-of-stack to xmm1 and the operand below it to xmm0.	*/
+static void EmitBinaryArgs(
+	JIT_BUFFER* buff,
+	const size_t depth)
+{
+	const uint8_t op[] = { 0xF2, 0x0F, 0x10, 0xC8 };
+
+	Emit(buff, op, sizeof(op));
+	EmitLoadSlot(buff, 0, depth - 2);
+}
+
+/* The top-of-stack lives in xmm0 and the values below it in a frame of
+ * slots addressed from rsp, so a slot is never live across a call. The
+ * temporaries take the slots after the stack ones. */
+static void EmitInstr(
+	JIT_BUFFER* buff,
+	const MEVE_PROGRAM* prog,
+	const uint8_t opc,
+	const uint16_t arg,
+	size_t* depth)
+{
+	static const uint8_t sseOp[MEVE_OP_COUNT] =
+	{
+		[MEVE_OP_ADD] = 0x58,
+		[MEVE_OP_SUB] = 0x5C,
+		[MEVE_OP_MUL] = 0x59,
+		[MEVE_OP_DIV] = 0x5E,
+	};
+	static const JIT_FUNC libmFun[MEVE_OP_COUNT] =
+	{
+		[MEVE_OP_EXP] = (JIT_FUNC)&MEVE_MATH(exp),
+		[MEVE_OP_SIN] = (JIT_FUNC)&MEVE_MATH(sin),
+		[MEVE_OP_COS] = (JIT_FUNC)&MEVE_MATH(cos),
+		[MEVE_OP_TAN] = (JIT_FUNC)&MEVE_MATH(tan),
+		[MEVE_OP_ASIN] = (JIT_FUNC)&MEVE_MATH(asin),
+		[MEVE_OP_ACOS] = (JIT_FUNC)&MEVE_MATH(acos),
+		[MEVE_OP_ATAN] = (JIT_FUNC)&MEVE_MATH(atan),
+		[MEVE_OP_LOG10] = (JIT_FUNC)&MEVE_MATH(log10),
+		[MEVE_OP_LOG] = (JIT_FUNC)&MEVE_MATH(log),
+		[MEVE_OP_MOD] = (JIT_FUNC)&MEVE_MATH(fmod),
+		[MEVE_OP_POW] = (JIT_FUNC)&MEVE_MATH(pow),
+	};
+
+	switch (opc)
+	{
+		case MEVE_OP_PUSHK:
+		{
+			/* movsd xmm0, [rip + disp32] */
+			const uint8_t op[] = { 0xF2, 0x0F, 0x10, 0x05 };
+
+			if (*depth)
+			{
+				EmitStoreSlot(buff, *depth - 1);
+			}
+
+			Emit(buff, op, sizeof(op));
+			Emit32(buff, (uint32_t)(buff->pool + arg * sizeof(num_t) - (buff->len + 4)));
+			(*depth)++;
+			break;
+		}
+		case MEVE_OP_LOADV:
+		{
+			/* movsd xmm0, [rax] */
+			const uint8_t op[] = { 0xF2, 0x0F, 0x10, 0x00 };
+
+			if (*depth)
+			{
+				EmitStoreSlot(buff, *depth - 1);
+			}
+
+			EmitMovRax(buff, (uint64_t)(uintptr_t)prog->vars[arg].ptr);
+			Emit(buff, op, sizeof(op));
+			(*depth)++;
+			break;
+		}
+		case MEVE_OP_LOADT:
+		{
+			if (*depth)
+			{
+				EmitStoreSlot(buff, *depth - 1);
+			}
+
+			EmitLoadSlot(buff, 0, prog->depth + arg);
+			(*depth)++;
+			break;
+		}
+		case MEVE_OP_POS:
+		{
+			break;
+		}
+		case MEVE_OP_STORE:
+		{
+			EmitStoreSlot(buff, prog->depth + arg);
+			break;
+		}
+		case MEVE_OP_NEG:
+		case MEVE_OP_ABS:
+		{
+			/* movq xmm1, rax; xorpd/andpd xmm0, xmm1 */
+			const uint8_t op[] =
+			{
+				0x66, 0x48, 0x0F, 0x6E, 0xC8,
+				0x66, 0x0F, opc == MEVE_OP_NEG ? 0x57 : 0x54, 0xC1
+			};
+
+			EmitMovRax(buff, opc == MEVE_OP_NEG ? 0x8000000000000000ULL : 0x7FFFFFFFFFFFFFFFULL);
+			Emit(buff, op, sizeof(op));
+			break;
+		}
+		case MEVE_OP_SQRT:
+		{
+			/* sqrtsd xmm0, xmm0 */
+			const uint8_t op[] = { 0xF2, 0x0F, 0x51, 0xC0 };
+
+			Emit(buff, op, sizeof(op));
+			break;
+		}
+		case MEVE_OP_FACT:
+		case MEVE_OP_CALL1:
+		{
+			num_t(*fPtr)(const num_t*) = opc == MEVE_OP_CALL1 ? prog->fPool[arg] : NULL;
+
+			if (!fPtr)
+			{
+				MeveOpCallback(opc, &fPtr);
+			}
+
+			EmitStoreSlot(buff, *depth - 1);
+			EmitArgSlot(buff, *depth - 1);
+			EmitCall(buff, (JIT_FUNC)fPtr);
+			break;
+		}
+		case MEVE_OP_ADD:
+		case MEVE_OP_SUB:
+		case MEVE_OP_MUL:
+		case MEVE_OP_DIV:
+		{
+			/* op xmm0, xmm1 */
+			const uint8_t op[] = { 0xF2, 0x0F, sseOp[opc], 0xC1 };
+
+			EmitBinaryArgs(buff, *depth);
+			Emit(buff, op, sizeof(op));
+			(*depth)--;
+			break;
+		}
+		case MEVE_OP_CHOOSE:
+		case MEVE_OP_MIN:
+		case MEVE_OP_MAX:
+		case MEVE_OP_CALL2:
+		{
+			/* Min and Max go through the callbacks of the interpreter so
+			 * that the sign of a zero result matches. */
+			num_t(*fPtr)(const num_t*) = opc == MEVE_OP_CALL2 ? prog->fPool[arg] : NULL;
+
+			if (!fPtr)
+			{
+				MeveOpCallback(opc, &fPtr);
+			}
+
+			EmitStoreSlot(buff, *depth - 1);
+			EmitArgSlot(buff, *depth - 2);
+			EmitCall(buff, (JIT_FUNC)fPtr);
+			(*depth)--;
+			break;
+		}
+		default:
+		{
+			if (MEVE_OP_ARITY(opc) == 2)
+			{
+				EmitBinaryArgs(buff, *depth);
+				(*depth)--;
+			}
+			EmitCall(buff, libmFun[opc]);
+		}
+	}
+}
+
+MeveCode MeveJitCompile(
+	const MEVE_PROGRAM* prog,
+	MEVE_JIT* jit)
+{
+	/* push rbp; mov rbp, rsp; sub rsp, imm32 */
+	const uint8_t prologue[] = { 0x55, 0x48, 0x89, 0xE5, 0x48, 0x81, 0xEC };
+	/* leave; ret */
+	const uint8_t epilogue[] = { 0xC9, 0xC3 };
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	JIT_BUFFER buff;
+	const uint16_t* ap;
+	size_t depth = 0;
+
+	if (!prog || !prog->ops || !jit)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	jit->prog = prog;
+	jit->fn = NULL;
+	jit->mem = NULL;
+	jit->size = 0;
+
+	/* The stack frame is kept as small as the interpreter's local stack. */
+	if (prog->depth + prog->tLen > MAXLEN_TBUFFER)
+	{
+		return MEVE_ERR_OK;
+	}
+
+	/* The constant pool is placed before the code, so its displacements
+	 * are known while emitting. */
+	buff.pool = 0;
+	buff.len = (prog->kLen * sizeof(num_t) + 15) & ~(size_t)15;
+	jit->size = buff.len + JIT_MAXLEN_FRAME + (prog->len + 1) * JIT_MAXLEN_INSTR;
+	jit->size = (jit->size + page - 1) / page * page;
+
+	jit->mem = mmap(NULL, jit->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (jit->mem == MAP_FAILED)
+	{
+		jit->mem = NULL;
+		jit->size = 0;
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	buff.code = jit->mem;
+	memcpy(buff.code, prog->kPool, prog->kLen * sizeof(num_t));
+
+	const size_t entry = buff.len;
+
+	Emit(&buff, prologue, sizeof(prologue));
+	Emit32(&buff, (uint32_t)(((prog->depth + prog->tLen) * sizeof(num_t) + 15) & ~(size_t)15));
+	ap = prog->args;
+
+	for (const uint8_t* pc = prog->ops, *end = pc + prog->len; pc != end; pc++)
+	{
+		EmitInstr(&buff, prog, *pc, MEVE_OP_HAS_ARG(*pc) ? *ap++ : 0, &depth);
+	}
+
+	Emit(&buff, epilogue, sizeof(epilogue));
+
+	/* The pages are never writable and executable at the same time. */
+	if (mprotect(jit->mem, jit->size, PROT_READ | PROT_EXEC))
+	{
+		MeveJitFree(jit);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	jit->fn = (MEVE_JITFN)(uintptr_t)&buff.code[entry];
+	return MEVE_ERR_OK;
+}
+
+void MeveJitFree(
+	MEVE_JIT* jit)
+{
+	if (jit->mem)
+	{
+		munmap(jit->mem, jit->size);
+	}
+
+	jit->fn = NULL;
+	jit->mem = NULL;
+	jit->size = 0;
+}
+#else
+MeveCode MeveJitCompile(
+	const MEVE_PROGRAM* prog,
+	MEVE_JIT* jit)
+{
+	if (!prog || !prog->ops || !jit)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	jit->prog = prog;
+	jit->fn = NULL;
+	jit->mem = NULL;
+	jit->size = 0;
+	return MEVE_ERR_OK;
+}
+
+void MeveJitFree(
+	MEVE_JIT* jit)
+{
+	jit->fn = NULL;
+}
+#endif
+
+MeveCode MeveJitRun(
+	const MEVE_JIT* jit,
+	num_t* res)
+{
+	if (!jit || !res)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	if (!jit->fn)
+	{
+		return MeveRun(jit->prog, res);
+	}
+
+	*res = jit->fn();
+	return MEVE_ERR_OK;
+}
\ No newline at end of file
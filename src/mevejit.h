@@ -0,0 +1,58 @@
+#ifndef MEVEJIT_H
+#define MEVEJIT_H
+#include "meve.h"
+
+/* Native code is generated on Linux x86-64 for the double precision
+ * build. Elsewhere MeveJitCompile() succeeds without native code and
+ * MeveJitRun() falls back to MeveRun().
+*/
+#if defined(__x86_64__) && defined(__linux__) && defined(MEVE_NUM_DOUBLE)
+#define MEVE_JIT_NATIVE
+#endif
+
+/* Compiled native function.			*/
+typedef num_t(*MEVE_JITFN)(void);
+
+/* Native program.						*/
+typedef struct MEVE_JIT
+{
+	const MEVE_PROGRAM* prog;	/* Pointer to the source program.		*/
+	MEVE_JITFN fn;				/* Native function, or NULL.			*/
+	void* mem;					/* Pointer to the executable pages.		*/
+	size_t size;				/* Size of the executable pages.		*/
+}MEVE_JIT;
+
+/* Compiles a program into native code.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * The program must outlive the native program. The addresses of the
+ * variables are read from prog->vars while compiling, so the values they
+ * point to can change but the table entries cannot.
+ * When native code is not available, or the program needs more than
+ * MAXLEN_TBUFFER stack entries, jit->fn is NULL.
+*/
+MeveCode MeveJitCompile(
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	MEVE_JIT* jit);				/* Pointer to the native program to be filled.	*/
+
+/* Evaluates a native program.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Falls back to MeveRun() when there is no native code.
+*/
+MeveCode MeveJitRun(
+	const MEVE_JIT* jit,		/* Pointer to a native program.			*/
+	num_t* res);				/* Receives the result.					*/
+
+/* Releases the resources of a native program.
+ *
+ * Remarks:
+ * The jit pointer cannot be null.
+*/
+void MeveJitFree(
+	MEVE_JIT* jit);				/* Pointer to a native program.			*/
+#endif
\ No newline at end of file
@@ -1,8 +1,92 @@
+/* lgamma_r() and its variants are extensions of the C library. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
 #include "mevemath.h"
 #ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
 #endif
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* Number of factorials that can be finite in num_t.		*/
+#if MEVE_NUM_MAX_EXP >= 16384
+#define FACT_TABLE_LEN			1755
+#elif MEVE_NUM_MAX_EXP >= 1024
+#define FACT_TABLE_LEN			171
+#else
+#define FACT_TABLE_LEN			35
+#endif
+
+/* lgamma_r() of num_t, whose suffix does not follow MEVE_MATH().	*/
+#if defined(MEVE_NUM_FLOAT)
+#define LGAMMA_R				lgammaf_r
+#elif defined(MEVE_NUM_DOUBLE)
+#define LGAMMA_R				lgamma_r
+#else
+#define LGAMMA_R				lgammal_r
+#endif
+
+/* Smallest argument of the asymptotic series of the digamma function.	*/
+#define DIGAMMA_MINASYMP		20
+
+/* Largest k for which n choose k is computed by multiplying.	*/
+#define CHOOSE_MAXSTEPS			1024
+
+/* Results below this bound are computed exactly by multiplying.	*/
+#define CHOOSE_EXACT			((num_t)2 * (num_t)(UINT64_C(1) << (MEVE_NUM_MANT_DIG - 1)))
+
+static num_t gFact[FACT_TABLE_LEN];
+static size_t gFactLen;
+
+/* Builds the table in the first evaluation that needs it. */
+static pthread_once_t gFactOnce = PTHREAD_ONCE_INIT;
+
+/* Fills the table with the factorials that are finite in num_t. */
+static void FactorialInit(void)
+{
+	/* Each entry is the previous one times its index, as a loop up to the
+	 * argument would compute it. */
+	gFact[0] = 1;
+
+	for (gFactLen = 1; gFactLen < FACT_TABLE_LEN; gFactLen++)
+	{
+		const num_t f = gFact[gFactLen - 1] * (num_t)gFactLen;
+
+		if (isinf(f))
+		{
+			break;
+		}
+		gFact[gFactLen] = f;
+	}
+}
+
+/* Greatest common divisor of two integers up to CHOOSE_MAXSTEPS. */
+static num_t ChooseGcd(
+	num_t a,
+	num_t b)
+{
+	while (b != 0)
+	{
+		const num_t r = MEVE_MATH(fmod)(a, b);
+
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/* n choose k in log-space, for n >= k >= 0. */
+static num_t ChooseLog(
+	const num_t n,
+	const num_t k)
+{
+	const num_t arg[3] = { n + 1, k + 1, n - k + 1 };
+
+	return MEVE_MATH(exp)(LogGamma(&arg[0]) - LogGamma(&arg[1]) - LogGamma(&arg[2]));
+}
 
 num_t Add(
 	const num_t* n)
@@ -43,20 +127,21 @@ num_t Div(
 num_t Pow(
 	const num_t* n)
 {	
-	return powl(n[0], n[1]);
+	return MEVE_MATH(pow)(n[0], n[1]);
 }
 
 num_t Mod(
 	const num_t* arg)
 {
-	return fmodl(arg[0], arg[1]);
+	return MEVE_MATH(fmod)(arg[0], arg[1]);
 }
 
 num_t Choose(
 	const num_t* n)
 {
-	num_t res;
-	const num_t lim = n[0] - n[1] > n[1] ? n[1] : n[0] - n[1];
+	num_t res = 1;
+	num_t k;
+	num_t i;
 
 	if (n[1] > n[0] || n[0] < 0 || n[1] < 0)
 	{
@@ -66,149 +151,242 @@ num_t Choose(
 	{
 		return 1;
 	}
-	
-	res = n[0];
-	for (num_t i = 1; i < lim; i++)
+	else if (isinf(n[0]))
+	{
+		return n[0];
+	}
+	else if (MEVE_MATH(floor)(n[0]) != n[0] || MEVE_MATH(floor)(n[1]) != n[1])
+	{
+		return ChooseLog(n[0], n[1]);
+	}
+
+	k = n[0] - n[1] < n[1] ? n[0] - n[1] : n[1];
+
+	pthread_once(&gFactOnce, &FactorialInit);
+
+	if (k > CHOOSE_MAXSTEPS)
+	{
+		/* The result can only be finite for an n small enough for lgamma
+		 * to keep its precision. */
+		return n[0] < (num_t)gFactLen
+			? gFact[(size_t)n[0]] / gFact[(size_t)k] / gFact[(size_t)(n[0] - k)]
+			: ChooseLog(n[0], k);
+	}
+
+	/* While the falling factorial fits the mantissa it is exact, and so is
+	 * its one division by k!. */
+	for (i = 0; i < k && res < CHOOSE_EXACT; i++)
 	{
 		res *= n[0] - i;
 	}
 
-	return res / Factorial(&lim);
+	if (i == k && res < CHOOSE_EXACT)
+	{
+		return res / gFact[(size_t)k];
+	}
+	else if (n[0] < (num_t)gFactLen)
+	{
+		res = gFact[(size_t)n[0]] / gFact[(size_t)k] / gFact[(size_t)(n[0] - k)];
+
+		if (res >= CHOOSE_EXACT)
+		{
+			return res;
+		}
+	}
+
+	/* Each partial result is the integer C(n - k + i, i), at most the
+	 * result. With g the gcd of i and n - k + i, i / g divides the previous
+	 * partial result, so dividing by it before multiplying keeps every
+	 * step exact while the result fits the mantissa, and finite while the
+	 * result is. */
+	res = 1;
+
+	for (i = 1; i <= k; i++)
+	{
+		const num_t m = n[0] - k + i;
+		const num_t g = ChooseGcd(i, MEVE_MATH(fmod)(m, i));
+
+		res = res / (i / g) * (m / g);
+	}
+	return res;
 }
 
 num_t Exp(
 	const num_t* arg)
 {
-	return expl(arg[0]);
+	return MEVE_MATH(exp)(arg[0]);
 }
 
 num_t Log(
 	const num_t* arg)
 {
-	return logl(arg[0]);
+	return MEVE_MATH(log)(arg[0]);
 }
 
 num_t Log10(
 	const num_t* arg)
 {
-	return log10l(arg[0]);
+	return MEVE_MATH(log10)(arg[0]);
 }
 
 num_t Sin(
 	const num_t* arg)
 {
-	return sinl(arg[0]);
+	return MEVE_MATH(sin)(arg[0]);
 }
 
 num_t Cos(
 	const num_t* arg)
 {
-	return cosl(arg[0]);
+	return MEVE_MATH(cos)(arg[0]);
 }
 
 num_t Tan(
 	const num_t* arg)
 {
-	return tanl(arg[0]);
+	return MEVE_MATH(tan)(arg[0]);
 }
 
 num_t ArcSin(
 	const num_t* arg)
 {
-	return asinl(arg[0]);
+	return MEVE_MATH(asin)(arg[0]);
 }
 
 num_t ArcCos(
 	const num_t* arg)
 {
-	return acosl(arg[0]);
+	return MEVE_MATH(acos)(arg[0]);
 }
 
 num_t ArcTan(
 	const num_t* arg)
 {
-	return atanl(arg[0]);
+	return MEVE_MATH(atan)(arg[0]);
 }
 
 num_t Sinh(
 	const num_t* arg)
 {
-	return sinhl(arg[0]);
+	return MEVE_MATH(sinh)(arg[0]);
 }
 
 num_t Cosh(
 	const num_t* arg)
 {
-	return coshl(arg[0]);
+	return MEVE_MATH(cosh)(arg[0]);
 }
 
 num_t Tanh(
 	const num_t* arg)
 {
-	return tanhl(arg[0]);
+	return MEVE_MATH(tanh)(arg[0]);
 }
 
 num_t ArcSinh(
 	const num_t* arg)
 {
-	return asinhl(arg[0]);
+	return MEVE_MATH(asinh)(arg[0]);
 }
 
 num_t ArcCosh(
 	const num_t* arg)
 {
-	return acoshl(arg[0]);
+	return MEVE_MATH(acosh)(arg[0]);
 }
 
 num_t ArcTanh(
 	const num_t* arg)
 {
-	return atanhl(arg[0]);
+	return MEVE_MATH(atanh)(arg[0]);
 }
 
 num_t Sqrt(
 	const num_t* arg)
 {
-	return sqrtl(arg[0]);
+	return MEVE_MATH(sqrt)(arg[0]);
 }
 
 num_t Abs(
 	const num_t* arg)
 {
-	return fabsl(arg[0]);
+	return MEVE_MATH(fabs)(arg[0]);
 }
 
 num_t Factorial(
 	const num_t* arg)
 {
-	num_t res;
-
-	if (*arg < 0 || (ceill(*arg) != *arg))
-	{		
+	/* Also rejects NaN. */
+	if (!(*arg >= 0))
+	{
 		return 0;
 	}
 
-	if (*arg == 0 || *arg == 1)
+	if (MEVE_MATH(floor)(*arg) != *arg)
 	{
-		return 1;
+		return MEVE_MATH(tgamma)(*arg + 1);
 	}
 
-	res = 2.0L;
-	for (num_t i = 3.0L; i <= *arg; i++)
+	pthread_once(&gFactOnce, &FactorialInit);
+
+	return *arg < (num_t)gFactLen ? gFact[(size_t)*arg] : (num_t)INFINITY;
+}
+
+num_t LogGamma(
+	const num_t* arg)
+{
+#ifdef __GLIBC__
+	int sign;
+
+	return LGAMMA_R(arg[0], &sign);
+#else
+	/* The sign written to signgam is never read by the engine. */
+	return MEVE_MATH(lgamma)(arg[0]);
+#endif
+}
+
+num_t Digamma(
+	const num_t* arg)
+{
+	const num_t pi = 3.141592653589793238462643383279502884L;
+	num_t x = *arg;
+	num_t res = 0;
+	num_t x2;
+
+	if (x <= 0 && MEVE_MATH(floor)(x) == x)
 	{
-		res *= i;
+		return (num_t)NAN;
 	}
-	return res;
+
+	/* Reflection: psi(x) = psi(1 - x) - pi / tan(pi * x). */
+	if (x < 0)
+	{
+		res = -pi / MEVE_MATH(tan)(pi * x);
+		x = 1 - x;
+	}
+
+	/* Recurrence: psi(x) = psi(x + 1) - 1 / x. */
+	for (; x < DIGAMMA_MINASYMP; x++)
+	{
+		res -= 1 / x;
+	}
+
+	/* Asymptotic series, with the Bernoulli numbers B2 to B14. */
+	x2 = 1 / (x * x);
+
+	return res + MEVE_MATH(log)(x) - (num_t)0.5 / x - x2 * ((num_t)1 / 12 -
+		x2 * ((num_t)1 / 120 - x2 * ((num_t)1 / 252 - x2 * ((num_t)1 / 240 -
+		x2 * ((num_t)1 / 132 - x2 * ((num_t)691 / 32760 - x2 * ((num_t)1 / 12)))))));
 }
 
 num_t Min(
 	const num_t* arg)
 {
-	return fminl(arg[0], arg[1]);
+	return MEVE_MATH(fmin)(arg[0], arg[1]);
 }
 
 num_t Max(
 	const num_t* arg)
 {
-	return fmaxl(arg[0], arg[1]);
+	return MEVE_MATH(fmax)(arg[0], arg[1]);
 }
\ No newline at end of file
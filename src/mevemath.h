@@ -66,10 +66,23 @@ num_t ArcTanh(
 num_t Sqrt(
 	const num_t* arg);
 
-/* Returns the factorial of arg[0].										*/
+/* Returns the factorial of arg[0], or Gamma(arg[0] + 1) when it is not an
+ * integer. Negative arguments return 0.								*/
 num_t Factorial(
 	const num_t* arg);
 
+/* Returns the digamma function of arg[0], the derivative of the natural
+ * logarithm of Gamma(arg[0]).											*/
+num_t Digamma(
+	const num_t* arg);
+
+/* Returns the natural logarithm of the absolute value of Gamma(arg[0]).
+ * With glibc it calls lgamma_r() and can be called from any thread; with
+ * other C libraries lgamma() writes the global signgam, which is never
+ * read by the engine but makes concurrent calls a data race.			*/
+num_t LogGamma(
+	const num_t* arg);
+
 /* Returns the absolute value of arg[0].								*/
 num_t Abs(
 	const num_t* arg);
@@ -86,7 +99,8 @@ num_t Max(
 num_t Mod(
 	const num_t* arg);
 
-/* Returns the n[1]-combination of n[0] elements.						*/
+/* Returns the n[1]-combination of n[0] elements, extended to non-integers
+ * through the gamma function.											*/
 num_t Choose(
 	const num_t* n);
 
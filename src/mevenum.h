@@ -1,4 +1,62 @@
 #ifndef MEVENUM_H
 #define MEVENUM_H
+#include <float.h>
+
+/* The precision of the engine is selected when it is compiled:
+ *
+ * MEVE_NUM_FLOAT	float, symbols prefixed with meve_f_.
+ * MEVE_NUM_DOUBLE	double, symbols prefixed with meve_d_.
+ * (default)		long double, symbols not prefixed.
+ *
+ * Each translation unit uses a single precision, but the variants have
+ * distinct symbols and can be linked into the same binary.
+*/
+#if defined(MEVE_NUM_FLOAT)
+typedef float num_t;
+#define MEVE_NUM_MANT_DIG	FLT_MANT_DIG
+#define MEVE_NUM_MAX_EXP	FLT_MAX_EXP
+#define MEVE_NUM_EPSILON	FLT_EPSILON
+#define MEVE_NUM_FMT		"g"
+#define MEVE_NUM_DIG		FLT_DECIMAL_DIG
+#define MEVE_NUM_PREFIX		meve_f_
+#define MEVE_MATH(fn)		fn##f
+#define MEVE_STRTONUM(s, e)	strtof(s, e)
+#elif defined(MEVE_NUM_DOUBLE)
+typedef double num_t;
+#define MEVE_NUM_MANT_DIG	DBL_MANT_DIG
+#define MEVE_NUM_MAX_EXP	DBL_MAX_EXP
+#define MEVE_NUM_EPSILON	DBL_EPSILON
+#define MEVE_NUM_FMT		"g"
+#define MEVE_NUM_DIG		DBL_DECIMAL_DIG
+#define MEVE_NUM_PREFIX		meve_d_
+#define MEVE_MATH(fn)		fn
+#define MEVE_STRTONUM(s, e)	strtod(s, e)
+#else
 typedef long double num_t;
+
+/* Number of mantissa bits of num_t.	*/
+#define MEVE_NUM_MANT_DIG	LDBL_MANT_DIG
+
+/* Largest binary exponent of num_t.	*/
+#define MEVE_NUM_MAX_EXP	LDBL_MAX_EXP
+
+/* Difference between 1 and the next num_t.	*/
+#define MEVE_NUM_EPSILON	LDBL_EPSILON
+
+/* Conversion of num_t for printf().	*/
+#define MEVE_NUM_FMT		"Lg"
+
+/* Significant digits that print num_t without loss.	*/
+#define MEVE_NUM_DIG		LDBL_DECIMAL_DIG
+
+/* Name of the math.h function for num_t.	*/
+#define MEVE_MATH(fn)		fn##l
+
+/* Converts a string to num_t.			*/
+#define MEVE_STRTONUM(s, e)	strtold(s, e)
+#endif
+
+#ifdef MEVE_NUM_PREFIX
+#include "mevesym.h"
+#endif
 #endif
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "mevepool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct POOL_JOB POOL_JOB;
+typedef struct POOL_WORKER POOL_WORKER;
+
+/* Job run by the pool.					*/
+struct POOL_JOB
+{
+	MeveCode(*fn)(const POOL_JOB*, POOL_WORKER*, size_t);	/* Runs a chunk.	*/
+	size_t chunks;				/* Number of chunks.					*/
+	const char* const* strs;	/* Pointer to the input-strings.		*/
+	size_t count;				/* Number of input-strings.				*/
+	MeveCode* codes;			/* Receives one code per expression.	*/
+	const MEVE_PROGRAM* prog;	/* Pointer to a compiled program.		*/
+	const num_t* const* cols;	/* Pointer to the input columns.		*/
+	size_t rows;				/* Number of rows.						*/
+	num_t* res;					/* Receives the results.				*/
+};
+
+/* Per-thread state. The token buffer keeps the queues of two workers
+ * on different cache lines. */
+struct POOL_WORKER
+{
+	pthread_mutex_t lock;		/* Protects the chunk range.			*/
+	size_t head;				/* First chunk left in the range.		*/
+	size_t tail;				/* Chunk past the end of the range.		*/
+	MeveCode code;				/* Code of the last failed chunk.		*/
+	MEVE_POOL* pool;			/* Pointer to the owning pool.			*/
+	size_t index;				/* Index of the worker in the pool.		*/
+	const num_t** cols;			/* Columns shifted to the chunk rows.	*/
+	size_t colsLen;				/* Number of entries in cols.			*/
+	MEVE_CONTEXT ctx;			/* Scratch context.						*/
+	MEVE_ARENA arena;			/* Storage of the longer expressions.	*/
+	MTOKEN tkBuff[MAXLEN_TBUFFER];	/* Scratch token buffer.			*/
+};
+
+struct MEVE_POOL
+{
+	POOL_WORKER** workers;		/* Workers, the first is the caller.	*/
+	pthread_t* threads;			/* Threads of workers[1..count).		*/
+	size_t count;				/* Number of workers.					*/
+	size_t started;				/* Number of threads started.			*/
+	pthread_mutex_t lock;		/* Protects the fields below.			*/
+	pthread_cond_t start;		/* Signaled when a job is posted.		*/
+	pthread_cond_t done;		/* Signaled when the last thread is idle.	*/
+	const POOL_JOB* job;		/* Job being run.						*/
+	uint64_t gen;				/* Number of jobs posted.				*/
+	size_t active;				/* Threads still running the job.		*/
+	bool stop;					/* Set when the pool is released.		*/
+};
+
+static bool PoolPop(
+	POOL_WORKER* w,
+	size_t* chunk)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->head < w->tail)
+	{
+		*chunk = w->head++;
+		found = true;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return found;
+}
+
+static bool PoolSteal(
+	POOL_WORKER* w)
+{
+	MEVE_POOL* pool = w->pool;
+
+	/* Takes the back half of the first victim with work left, so the
+	 * owner keeps running the chunks next to the ones it has done. */
+	for (size_t i = 1; i < pool->count; i++)
+	{
+		POOL_WORKER* victim = pool->workers[(w->index + i) % pool->count];
+		size_t head = 0;
+		size_t tail = 0;
+
+		pthread_mutex_lock(&victim->lock);
+		if (victim->head < victim->tail)
+		{
+			tail = victim->tail;
+			head = tail - (victim->tail - victim->head + 1) / 2;
+			victim->tail = head;
+		}
+		pthread_mutex_unlock(&victim->lock);
+
+		if (head < tail)
+		{
+			pthread_mutex_lock(&w->lock);
+			w->head = head;
+			w->tail = tail;
+			pthread_mutex_unlock(&w->lock);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void PoolWork(
+	POOL_WORKER* w,
+	const POOL_JOB* job)
+{
+	size_t chunk;
+
+	do
+	{
+		while (PoolPop(w, &chunk))
+		{
+			const MeveCode code = job->fn(job, w, chunk);
+
+			if (code != MEVE_ERR_OK)
+			{
+				w->code = code;
+			}
+		}
+	} while (PoolSteal(w));
+}
+
+static void* PoolThread(
+	void* arg)
+{
+	POOL_WORKER* w = arg;
+	MEVE_POOL* pool = w->pool;
+	uint64_t gen = 0;
+
+	for (;;)
+	{
+		const POOL_JOB* job;
+
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && pool->gen == gen)
+		{
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+
+		if (pool->stop)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+
+		gen = pool->gen;
+		job = pool->job;
+		pthread_mutex_unlock(&pool->lock);
+
+		PoolWork(w, job);
+
+		pthread_mutex_lock(&pool->lock);
+		if (!--pool->active)
+		{
+			pthread_cond_signal(&pool->done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static MeveCode PoolRun(
+	MEVE_POOL* pool,
+	const POOL_JOB* job)
+{
+	MeveCode res = MEVE_ERR_OK;
+
+	/* The chunks are dealt in contiguous ranges, one per worker. */
+	for (size_t i = 0; i < pool->count; i++)
+	{
+		POOL_WORKER* w = pool->workers[i];
+
+		pthread_mutex_lock(&w->lock);
+		w->head = job->chunks * i / pool->count;
+		w->tail = job->chunks * (i + 1) / pool->count;
+		w->code = MEVE_ERR_OK;
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->active = pool->started;
+	pool->gen++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	PoolWork(pool->workers[0], job);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->active)
+	{
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pool->job = NULL;
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i < pool->count; i++)
+	{
+		if (pool->workers[i]->code != MEVE_ERR_OK)
+		{
+			res = pool->workers[i]->code;
+		}
+	}
+	return res;
+}
+
+static MeveCode PoolEvalChunk(
+	const POOL_JOB* job,
+	POOL_WORKER* w,
+	size_t chunk)
+{
+	const size_t first = chunk * MEVE_POOL_EXPRS;
+	const size_t last = first + MEVE_POOL_EXPRS < job->count ? first + MEVE_POOL_EXPRS : job->count;
+
+	for (size_t i = first; i < last; i++)
+	{
+		job->codes[i] = MEVE_ERR_INVALIDPARAM;
+
+		if (job->strs[i])
+		{
+			w->ctx.iStr = job->strs[i];
+			MeveUpdate(&w->ctx);
+			job->codes[i] = EvalString(&w->ctx);
+		}
+
+		job->res[i] = job->codes[i] == MEVE_ERR_OK ? w->ctx.ans : 0;
+	}
+	return MEVE_ERR_OK;
+}
+
+static MeveCode PoolBatchChunk(
+	const POOL_JOB* job,
+	POOL_WORKER* w,
+	size_t chunk)
+{
+	const size_t row = chunk * MEVE_POOL_ROWS;
+	const size_t rows = job->rows - row < MEVE_POOL_ROWS ? job->rows - row : MEVE_POOL_ROWS;
+
+	for (size_t i = 0; i < job->prog->varCount; i++)
+	{
+		w->cols[i] = &job->cols[i][row];
+	}
+
+	return MeveRunBatch(job->prog, w->cols, rows, &job->res[row]);
+}
+
+MeveCode MevePoolCreate(
+	MEVE_POOL** pool,
+	size_t threads)
+{
+	MEVE_POOL* p;
+
+	if (!pool)
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	*pool = NULL;
+
+	if (!threads)
+	{
+		const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = cpus > 0 ? (size_t)cpus : 1;
+	}
+
+	if (!(p = calloc(1, sizeof(MEVE_POOL))))
+	{
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->start, NULL);
+	pthread_cond_init(&p->done, NULL);
+
+	p->workers = calloc(threads, sizeof(POOL_WORKER*));
+	p->threads = calloc(threads, sizeof(pthread_t));
+
+	if (!p->workers || !p->threads)
+	{
+		MevePoolFree(p);
+		return MEVE_ERR_OUTOFMEMORY;
+	}
+
+	for (; p->count < threads; p->count++)
+	{
+		POOL_WORKER* w = calloc(1, sizeof(POOL_WORKER));
+
+		if (!w)
+		{
+			MevePoolFree(p);
+			return MEVE_ERR_OUTOFMEMORY;
+		}
+
+		pthread_mutex_init(&w->lock, NULL);
+		w->pool = p;
+		w->index = p->count;
+		MeveInit(&w->ctx, w->tkBuff, sizeof(w->tkBuff), "");
+		MeveArenaInit(&w->arena, NULL, 0);
+		MeveSetArena(&w->ctx, &w->arena);
+		p->workers[p->count] = w;
+	}
+
+	for (size_t i = 1; i < threads; i++)
+	{
+		if (pthread_create(&p->threads[i], NULL, &PoolThread, p->workers[i]))
+		{
+			MevePoolFree(p);
+			return MEVE_ERR_OUTOFMEMORY;
+		}
+		p->started++;
+	}
+
+	*pool = p;
+	return MEVE_ERR_OK;
+}
+
+MeveCode MevePoolEval(
+	MEVE_POOL* pool,
+	const char* const* strs,
+	size_t count,
+	const MEVE_VAR* vars,
+	size_t varCount,
+	num_t* res,
+	MeveCode* codes)
+{
+	POOL_JOB job = { 0 };
+
+	if (!pool || (count && (!strs || !res || !codes)))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	for (size_t i = 0; i < pool->count; i++)
+	{
+		MeveSetVars(&pool->workers[i]->ctx, vars, varCount);
+	}
+
+	job.fn = &PoolEvalChunk;
+	job.chunks = (count + MEVE_POOL_EXPRS - 1) / MEVE_POOL_EXPRS;
+	job.strs = strs;
+	job.count = count;
+	job.codes = codes;
+	job.res = res;
+
+	return PoolRun(pool, &job);
+}
+
+MeveCode MevePoolRunBatch(
+	MEVE_POOL* pool,
+	const MEVE_PROGRAM* prog,
+	const num_t* const* cols,
+	size_t rows,
+	num_t* res)
+{
+	POOL_JOB job = { 0 };
+
+	if (!pool || !prog || !prog->ops || !res || (prog->varCount && !cols))
+	{
+		return MEVE_ERR_INVALIDPARAM;
+	}
+
+	for (size_t i = 0; i < pool->count; i++)
+	{
+		POOL_WORKER* w = pool->workers[i];
+
+		if (w->colsLen < prog->varCount)
+		{
+			const num_t** p = realloc(w->cols, prog->varCount * sizeof(num_t*));
+
+			if (!p)
+			{
+				return MEVE_ERR_OUTOFMEMORY;
+			}
+
+			w->cols = p;
+			w->colsLen = prog->varCount;
+		}
+	}
+
+	job.fn = &PoolBatchChunk;
+	job.chunks = (rows + MEVE_POOL_ROWS - 1) / MEVE_POOL_ROWS;
+	job.prog = prog;
+	job.cols = cols;
+	job.rows = rows;
+	job.res = res;
+
+	return PoolRun(pool, &job);
+}
+
+void MevePoolFree(
+	MEVE_POOL* pool)
+{
+	if (!pool)
+	{
+		return;
+	}
+
+	if (pool->started)
+	{
+		pthread_mutex_lock(&pool->lock);
+		pool->stop = true;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->lock);
+
+		for (size_t i = 1; i <= pool->started; i++)
+		{
+			pthread_join(pool->threads[i], NULL);
+		}
+	}
+
+	for (size_t i = 0; i < pool->count; i++)
+	{
+		pthread_mutex_destroy(&pool->workers[i]->lock);
+		MeveArenaFree(&pool->workers[i]->arena);
+		free(pool->workers[i]->cols);
+		free(pool->workers[i]);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	free(pool->workers);
+	free(pool->threads);
+	free(pool);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef MEVEPOOL_H
+#define MEVEPOOL_H
+#include "meve.h"
+
+/* Parallel evaluation on a pool of POSIX threads.
+ *
+ * Thread-safety model:
+ * A MEVE_CONTEXT and its token buffer are scratch state and belong to a
+ * single thread at a time. A compiled MEVE_PROGRAM or MEVE_JIT is never
+ * modified after it is built, so any number of threads can run it at once,
+ * as long as the variables it reads are not written meanwhile.
+ * The engine has two other tables, each built once and only read
+ * afterwards: the keywords, by the first MeveInit(), and the factorials,
+ * by the first evaluation of the ! or choose operators. Each is built
+ * under pthread_once(), so either can first be used from any thread and
+ * the threads that need it meanwhile wait until it is built.
+ * The log-gamma of the choose operator uses lgamma_r() with glibc; with
+ * other C libraries lgamma() writes the global signgam, which the engine
+ * never reads, from concurrent evaluations.
+*/
+
+/* Rows given to a worker at a time by MevePoolRunBatch().	*/
+#define MEVE_POOL_ROWS		(64 * MEVE_BATCH_BLOCK)
+
+/* Expressions given to a worker at a time by MevePoolEval().	*/
+#define MEVE_POOL_EXPRS		16
+
+/* Thread pool.							*/
+typedef struct MEVE_POOL MEVE_POOL;
+
+/* Creates a thread pool.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * When threads is 0 one thread per online processor is used. The calling
+ * thread counts as one of them, so threads - 1 threads are started.
+ * The pool must be released by calling MevePoolFree().
+*/
+MeveCode MevePoolCreate(
+	MEVE_POOL** pool,			/* Receives the pointer to the pool.	*/
+	size_t threads);			/* Number of threads, or 0.				*/
+
+/* Evaluates a set of expressions in parallel.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Each worker evaluates its expressions with EvalString() on a context of
+ * its own, bound to the given variable table. codes[i] receives the result
+ * of strs[i] and res[i] its value, or 0 when it failed.
+*/
+MeveCode MevePoolEval(
+	MEVE_POOL* pool,			/* Pointer to a thread pool.			*/
+	const char* const* strs,	/* Pointer to the input-strings.		*/
+	size_t count,				/* Number of input-strings.				*/
+	const MEVE_VAR* vars,		/* Pointer to the variable table, or NULL.	*/
+	size_t varCount,			/* Number of variables in the table.	*/
+	num_t* res,					/* Receives one result per expression.	*/
+	MeveCode* codes);			/* Receives one code per expression.	*/
+
+/* Evaluates a compiled program over a batch of rows in parallel.
+ *
+ * If the function succeeds, the return value is MEVE_ERR_OK.
+ *
+ * Remarks:
+ * Works like MeveRunBatch(), with the rows split in ranges of
+ * MEVE_POOL_ROWS. When a range fails, the code of one of the failures is
+ * returned and the results of the failed ranges are undefined.
+*/
+MeveCode MevePoolRunBatch(
+	MEVE_POOL* pool,			/* Pointer to a thread pool.			*/
+	const MEVE_PROGRAM* prog,	/* Pointer to a compiled program.		*/
+	const num_t* const* cols,	/* Pointer to the input columns.		*/
+	size_t rows,				/* Number of rows.						*/
+	num_t* res);				/* Receives one result per row.			*/
+
+/* Stops the threads and releases the resources of a pool.
+ *
+ * Remarks:
+ * Releasing a null pool is allowed.
+*/
+void MevePoolFree(
+	MEVE_POOL* pool);			/* Pointer to a thread pool.			*/
+#endif
\ No newline at end of file
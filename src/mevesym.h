@@ -0,0 +1,108 @@
+#ifndef MEVESYM_H
+#define MEVESYM_H
+
+/* Prefixes the external symbols of the engine with MEVE_NUM_PREFIX so
+ * that several precisions can be linked into the same binary.
+ *
+ * Remarks:
+ * Every function with external linkage must be listed here.
+*/
+#define MEVE_CAT_(a, b)			a##b
+#define MEVE_CAT(a, b)			MEVE_CAT_(a, b)
+#define MEVE_SYM(name)			MEVE_CAT(MEVE_NUM_PREFIX, name)
+
+/* meve.c								*/
+#define CreateTokens			MEVE_SYM(CreateTokens)
+#define InfixToPostfix			MEVE_SYM(InfixToPostfix)
+#define CreatePostfix			MEVE_SYM(CreatePostfix)
+#define PostfixOptimize			MEVE_SYM(PostfixOptimize)
+#define PostfixEval				MEVE_SYM(PostfixEval)
+#define EvalString				MEVE_SYM(EvalString)
+#define MeveCompile				MEVE_SYM(MeveCompile)
+#define MeveCompileParams		MEVE_SYM(MeveCompileParams)
+#define MeveRun					MEVE_SYM(MeveRun)
+#define MeveRunBatch			MEVE_SYM(MeveRunBatch)
+#define MeveFree				MEVE_SYM(MeveFree)
+#define MeveInit				MEVE_SYM(MeveInit)
+#define MeveSetVars				MEVE_SYM(MeveSetVars)
+#define MeveSetFlags			MEVE_SYM(MeveSetFlags)
+#define MeveCallbackName		MEVE_SYM(MeveCallbackName)
+#define MeveCallbackFind		MEVE_SYM(MeveCallbackFind)
+#define MeveOpCallback			MEVE_SYM(MeveOpCallback)
+#define MeveSetArena			MEVE_SYM(MeveSetArena)
+#define MeveArenaInit			MEVE_SYM(MeveArenaInit)
+#define MeveArenaReset			MEVE_SYM(MeveArenaReset)
+#define MeveArenaFree			MEVE_SYM(MeveArenaFree)
+#define MeveUpdate				MEVE_SYM(MeveUpdate)
+#define MeveStatsSnapshot		MEVE_SYM(MeveStatsSnapshot)
+#define MeveStatsReset			MEVE_SYM(MeveStatsReset)
+
+/* mevejit.c							*/
+#define MeveJitCompile			MEVE_SYM(MeveJitCompile)
+#define MeveJitRun				MEVE_SYM(MeveJitRun)
+#define MeveJitFree				MEVE_SYM(MeveJitFree)
+
+/* mevediff.c							*/
+#define MeveRunGrad				MEVE_SYM(MeveRunGrad)
+
+/* meveival.c							*/
+#define MeveRunInterval			MEVE_SYM(MeveRunInterval)
+
+/* meveincr.c							*/
+#define MeveIncrInit			MEVE_SYM(MeveIncrInit)
+#define MeveIncrRun				MEVE_SYM(MeveIncrRun)
+#define MeveIncrFree			MEVE_SYM(MeveIncrFree)
+
+/* mevebin.c							*/
+#define MeveImageWrite			MEVE_SYM(MeveImageWrite)
+#define MeveImageOpen			MEVE_SYM(MeveImageOpen)
+#define MeveImageProgram		MEVE_SYM(MeveImageProgram)
+#define MeveImageClose			MEVE_SYM(MeveImageClose)
+
+/* mevecache.c							*/
+#define MeveCacheCreate			MEVE_SYM(MeveCacheCreate)
+#define MeveCacheEval			MEVE_SYM(MeveCacheEval)
+#define MeveCacheEvalShape		MEVE_SYM(MeveCacheEvalShape)
+#define MeveCacheStats			MEVE_SYM(MeveCacheStats)
+#define MeveCacheClear			MEVE_SYM(MeveCacheClear)
+#define MeveCacheFree			MEVE_SYM(MeveCacheFree)
+
+/* mevepool.c							*/
+#define MevePoolCreate			MEVE_SYM(MevePoolCreate)
+#define MevePoolEval			MEVE_SYM(MevePoolEval)
+#define MevePoolRunBatch		MEVE_SYM(MevePoolRunBatch)
+#define MevePoolFree			MEVE_SYM(MevePoolFree)
+
+/* mevemath.c							*/
+#define Exp						MEVE_SYM(Exp)
+#define Log						MEVE_SYM(Log)
+#define Log10					MEVE_SYM(Log10)
+#define Sin						MEVE_SYM(Sin)
+#define Cos						MEVE_SYM(Cos)
+#define Tan						MEVE_SYM(Tan)
+#define ArcSin					MEVE_SYM(ArcSin)
+#define ArcCos					MEVE_SYM(ArcCos)
+#define ArcTan					MEVE_SYM(ArcTan)
+#define Sinh					MEVE_SYM(Sinh)
+#define Cosh					MEVE_SYM(Cosh)
+#define Tanh					MEVE_SYM(Tanh)
+#define ArcSinh					MEVE_SYM(ArcSinh)
+#define ArcCosh					MEVE_SYM(ArcCosh)
+#define ArcTanh					MEVE_SYM(ArcTanh)
+#define Sqrt					MEVE_SYM(Sqrt)
+#define Factorial				MEVE_SYM(Factorial)
+#define Digamma					MEVE_SYM(Digamma)
+#define LogGamma				MEVE_SYM(LogGamma)
+#define Abs						MEVE_SYM(Abs)
+#define Min						MEVE_SYM(Min)
+#define Max						MEVE_SYM(Max)
+#define Mod						MEVE_SYM(Mod)
+#define Choose					MEVE_SYM(Choose)
+#define Add						MEVE_SYM(Add)
+#define UnAdd					MEVE_SYM(UnAdd)
+#define Sub						MEVE_SYM(Sub)
+#define UnSub					MEVE_SYM(UnSub)
+#define Mult					MEVE_SYM(Mult)
+#define Div						MEVE_SYM(Div)
+#define Pow						MEVE_SYM(Pow)
+#endif
\ No newline at end of file
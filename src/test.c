@@ -8,6 +8,12 @@
 #define CLEAR "clear"
 #endif
 
+/* Size of the stdio buffers used by the batch mode.	*/
+#define BATCH_IOBUFF		(1 << 20)
+
+/* Initial size of the batch mode line buffer.	*/
+#define BATCH_LINEBUFF		(1 << 16)
+
 const char* GetErrorString(
 	MeveCode code)
 {
@@ -41,7 +47,129 @@ const char* GetErrorString(
 	return NULL;
 }
 
-int main()
+static void BatchLine(
+	MEVE_CONTEXT* ctx,
+	char* line,
+	size_t len,
+	FILE* out)
+{
+	MeveCode res;
+
+	if (len && line[len - 1] == '\r')
+	{
+		len--;
+	}
+	line[len] = '\0';
+
+	ctx->iStr = line;
+	MeveUpdate(ctx);
+
+	/* One record per input line: the error code, a tab and the result. */
+	if ((res = EvalString(ctx)) == MEVE_ERR_OK)
+	{
+		fprintf(out, "0\t%.*" MEVE_NUM_FMT "\n", MEVE_NUM_DIG, ctx->ans);
+	}
+	else
+	{
+		fprintf(out, "%d\t\n", (int)res);
+	}
+}
+
+/* Evaluates every line of a file, or of stdin when path is NULL, and
+ * writes the results to stdout. Lines have no length limit. */
+static int RunBatch(
+	const char* path)
+{
+	MEVE_CONTEXT ctx;
+	MEVE_ARENA arena;
+	MTOKEN tkBuff[256];
+	FILE* in = stdin;
+	size_t sz = BATCH_LINEBUFF;
+	size_t len = 0;
+	size_t n;
+	char* buff;
+	int ret = 0;
+
+	if (path && strcmp(path, "-") && !(in = fopen(path, "rb")))
+	{
+		perror(path);
+		return 1;
+	}
+
+	if (!(buff = malloc(sz + 1)))
+	{
+		if (in != stdin)
+		{
+			fclose(in);
+		}
+		return 1;
+	}
+
+	setvbuf(in, NULL, _IOFBF, BATCH_IOBUFF);
+	setvbuf(stdout, NULL, _IOFBF, BATCH_IOBUFF);
+
+	MeveInit(&ctx, tkBuff, sizeof(tkBuff), "");
+	MeveArenaInit(&arena, NULL, 0);
+	MeveSetArena(&ctx, &arena);
+
+	/* The input is read in large blocks and split in place. A partial
+	 * line is moved to the front and the buffer grows when it is full. */
+	while ((n = fread(&buff[len], 1, sz - len, in)) > 0)
+	{
+		char* line = buff;
+		char* end = &buff[len + n];
+		char* nl;
+
+		while ((nl = memchr(line, '\n', (size_t)(end - line))))
+		{
+			BatchLine(&ctx, line, (size_t)(nl - line), stdout);
+			line = nl + 1;
+		}
+
+		len = (size_t)(end - line);
+		memmove(buff, line, len);
+
+		if (len == sz)
+		{
+			char* p = realloc(buff, sz * 2 + 1);
+
+			if (!p)
+			{
+				ret = 1;
+				break;
+			}
+
+			buff = p;
+			sz *= 2;
+		}
+	}
+
+	/* A read error ends the loop like the end of the input; the partial
+	 * line is then not evaluated. */
+	if (!ret && ferror(in))
+	{
+		perror(path && strcmp(path, "-") ? path : "stdin");
+		ret = 1;
+	}
+
+	if (!ret && len)
+	{
+		BatchLine(&ctx, buff, len, stdout);
+	}
+
+	free(buff);
+	MeveArenaFree(&arena);
+
+	if (in != stdin)
+	{
+		fclose(in);
+	}
+	return fflush(stdout) ? 1 : ret;
+}
+
+int main(
+	int argc,
+	char** argv)
 {
 	MeveCode res;
 	MEVE_CONTEXT ctx;
@@ -49,6 +177,11 @@ int main()
 	
 	char iStr[512] = { '\0' };
 
+	if (argc > 1 && !strcmp(argv[1], "-b"))
+	{
+		return RunBatch(argc > 2 ? argv[2] : NULL);
+	}
+
 	MeveInit(&ctx, tkBuff, sizeof(tkBuff), iStr);
 
 	while (1)
@@ -63,7 +196,7 @@ int main()
 
 		if (!STRNICMP(iStr, "clear", strlen("clear")))
 		{
-			system("cls");
+			system(CLEAR);
 		}
 		else if (!STRNICMP(iStr, "exit", strlen("exit")))
 		{
@@ -71,7 +204,7 @@ int main()
 		}
 		else if ((res = EvalString(&ctx)) == MEVE_ERR_OK)
 		{
-			printf("\nans =\n   %Lg\n\n", ctx.ans);
+			printf("\nans =\n   %" MEVE_NUM_FMT "\n\n", ctx.ans);
 		}
 		else if (iStr[0] != '\n')
 		{